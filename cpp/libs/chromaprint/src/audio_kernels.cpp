@@ -0,0 +1,296 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#include <algorithm>
+#include "audio_kernels.h"
+
+extern "C" {
+#include "avresample/avcodec.h"
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CHROMAPRINT_AUDIO_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace chromaprint {
+
+// Everything here is integer arithmetic, so the vector code only has to do the same
+// operations as these loops, in any order, to give the same samples.
+
+static void DownmixStereoScalar(const int16_t *input, size_t begin, size_t length, int16_t *output) {
+	for (size_t i = begin; i < length; i++) {
+		output[i] = (input[2 * i] + input[2 * i + 1]) / 2;
+	}
+}
+
+static void DownmixStereoPlain(const int16_t *input, size_t length, int16_t *output) {
+	DownmixStereoScalar(input, 0, length, output);
+}
+
+template <int NumChannels>
+static void DownmixFixed(const int16_t *input, size_t length, int16_t *output) {
+	for (size_t i = 0; i < length; i++) {
+		int32_t sum = 0;
+		for (int j = 0; j < NumChannels; j++) {
+			sum += input[j];
+		}
+		output[i] = (int16_t)(sum / NumChannels);
+		input += NumChannels;
+	}
+}
+
+static int32_t DotScalar(const int16_t *input, const int16_t *filter, int begin, int length, int32_t sum) {
+	for (int i = begin; i < length; i++) {
+		sum += input[i] * (int32_t) filter[i];
+	}
+	return sum;
+}
+
+static int32_t DotPlain(const int16_t *input, const int16_t *filter, int length) {
+	return DotScalar(input, filter, 0, length, 0);
+}
+
+// Same rounding and clipping as av_resample
+static inline int16_t RoundResampled(int32_t val) {
+	val = (val + (1 << 14)) >> 15;
+	return (unsigned)(val + 32768) > 65535 ? (val >> 31) ^ 32767 : val;
+}
+
+#ifdef CHROMAPRINT_AUDIO_KERNELS_X86
+
+// a + b of each stereo frame, then the division by two rounded toward zero like C does
+
+__attribute__((target("sse2")))
+static inline __m128i HalveSSE2(__m128i sum) {
+	return _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 31)), 1);
+}
+
+__attribute__((target("sse2")))
+static void DownmixStereoSSE2(const int16_t *input, size_t length, int16_t *output) {
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		__m128i lo = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (input + 2 * i)), ones);
+		__m128i hi = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (input + 2 * i + 8)), ones);
+		_mm_storeu_si128((__m128i *) (output + i), _mm_packs_epi32(HalveSSE2(lo), HalveSSE2(hi)));
+	}
+	DownmixStereoScalar(input, i, length, output);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i HalveAVX2(__m256i sum) {
+	return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_srli_epi32(sum, 31)), 1);
+}
+
+__attribute__((target("avx2")))
+static void DownmixStereoAVX2(const int16_t *input, size_t length, int16_t *output) {
+	const __m256i ones = _mm256_set1_epi16(1);
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m256i lo = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (input + 2 * i)), ones);
+		__m256i hi = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (input + 2 * i + 16)), ones);
+		// The pack works within 128 bit lanes, the permute puts the samples back in order
+		__m256i packed = _mm256_packs_epi32(HalveAVX2(lo), HalveAVX2(hi));
+		_mm256_storeu_si256((__m256i *) (output + i), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+	DownmixStereoScalar(input, i, length, output);
+}
+
+__attribute__((target("sse2")))
+static inline int32_t HorizontalSumSSE2(__m128i sum) {
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("sse2")))
+static int32_t DotSSE2(const int16_t *input, const int16_t *filter, int length) {
+	__m128i sum = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 8 <= length; i += 8) {
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (input + i)), _mm_loadu_si128((const __m128i *) (filter + i))));
+	}
+	return DotScalar(input, filter, i, length, HorizontalSumSSE2(sum));
+}
+
+__attribute__((target("avx2")))
+static int32_t DotAVX2(const int16_t *input, const int16_t *filter, int length) {
+	__m256i sum = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 16 <= length; i += 16) {
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (input + i)), _mm256_loadu_si256((const __m256i *) (filter + i))));
+	}
+	__m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	if (i + 8 <= length) {
+		sum4 = _mm_add_epi32(sum4, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (input + i)), _mm_loadu_si128((const __m128i *) (filter + i))));
+		i += 8;
+	}
+	return DotScalar(input, filter, i, length, HorizontalSumSSE2(sum4));
+}
+
+// Four outputs of one filter phase per pass, so every filter load feeds four products
+
+__attribute__((target("sse2")))
+static inline __m128i Reduce4SSE2(__m128i s0, __m128i s1, __m128i s2, __m128i s3) {
+	const __m128i t0 = _mm_add_epi32(_mm_unpacklo_epi32(s0, s1), _mm_unpackhi_epi32(s0, s1));
+	const __m128i t1 = _mm_add_epi32(_mm_unpacklo_epi32(s2, s3), _mm_unpackhi_epi32(s2, s3));
+	return _mm_add_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1));
+}
+
+// Rounds four sums like av_resample, the saturating pack does its clipping
+__attribute__((target("sse2")))
+static inline void StoreResampled4(__m128i sum, const int16_t *input, size_t step, const int16_t *filter, int begin, int length, int16_t *output) {
+	if (begin < length) {
+		sum = _mm_add_epi32(sum, _mm_setr_epi32(
+			DotScalar(input, filter, begin, length, 0),
+			DotScalar(input + step, filter, begin, length, 0),
+			DotScalar(input + 2 * step, filter, begin, length, 0),
+			DotScalar(input + 3 * step, filter, begin, length, 0)));
+	}
+	sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << 14)), 15);
+	_mm_storel_epi64((__m128i *) output, _mm_packs_epi32(sum, sum));
+}
+
+__attribute__((target("sse2")))
+static void FixedPhaseSSE2(const int16_t *input, size_t step, const int16_t *filter, int length, int16_t *output, size_t count) {
+	const int vector_length = length & ~7;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const int16_t *in = input + i * step;
+		__m128i s0 = _mm_setzero_si128(), s1 = s0, s2 = s0, s3 = s0;
+		for (int j = 0; j < vector_length; j += 8) {
+			const __m128i f = _mm_loadu_si128((const __m128i *) (filter + j));
+			s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (in + j)), f));
+			s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (in + step + j)), f));
+			s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (in + 2 * step + j)), f));
+			s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (in + 3 * step + j)), f));
+		}
+		StoreResampled4(Reduce4SSE2(s0, s1, s2, s3), in, step, filter, vector_length, length, output + i);
+	}
+	for (; i < count; i++) {
+		output[i] = RoundResampled(DotSSE2(input + i * step, filter, length));
+	}
+}
+
+__attribute__((target("avx2")))
+static inline __m128i Fold(__m256i sum) {
+	return _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+}
+
+__attribute__((target("avx2")))
+static void FixedPhaseAVX2(const int16_t *input, size_t step, const int16_t *filter, int length, int16_t *output, size_t count) {
+	const int vector_length = length & ~15;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const int16_t *in = input + i * step;
+		__m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+		for (int j = 0; j < vector_length; j += 16) {
+			const __m256i f = _mm256_loadu_si256((const __m256i *) (filter + j));
+			s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (in + j)), f));
+			s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (in + step + j)), f));
+			s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (in + 2 * step + j)), f));
+			s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (in + 3 * step + j)), f));
+		}
+		StoreResampled4(Reduce4SSE2(Fold(s0), Fold(s1), Fold(s2), Fold(s3)), in, step, filter, vector_length, length, output + i);
+	}
+	for (; i < count; i++) {
+		output[i] = RoundResampled(DotAVX2(input + i * step, filter, length));
+	}
+}
+
+#endif
+
+static void FixedPhasePlain(const int16_t *input, size_t step, const int16_t *filter, int length, int16_t *output, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		output[i] = RoundResampled(DotPlain(input + i * step, filter, length));
+	}
+}
+
+struct AudioKernels {
+	void (*downmix_stereo)(const int16_t *input, size_t length, int16_t *output);
+	int32_t (*dot)(const int16_t *input, const int16_t *filter, int length);
+	void (*fixed_phase)(const int16_t *input, size_t step, const int16_t *filter, int length, int16_t *output, size_t count);
+};
+
+static AudioKernels PickKernels() {
+	AudioKernels kernels = {
+		DownmixStereoPlain,
+		DotPlain,
+		FixedPhasePlain,
+	};
+#ifdef CHROMAPRINT_AUDIO_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		kernels.downmix_stereo = DownmixStereoAVX2;
+		kernels.dot = DotAVX2;
+		kernels.fixed_phase = FixedPhaseAVX2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		kernels.downmix_stereo = DownmixStereoSSE2;
+		kernels.dot = DotSSE2;
+		kernels.fixed_phase = FixedPhaseSSE2;
+	}
+#endif
+	return kernels;
+}
+
+static const AudioKernels &Kernels() {
+	static const AudioKernels kernels = PickKernels();
+	return kernels;
+}
+
+void DownmixStereo(const int16_t *input, size_t length, int16_t *output) {
+	Kernels().downmix_stereo(input, length, output);
+}
+
+void DownmixMultiChannel(const int16_t *input, size_t length, int num_channels, int16_t *output) {
+	// A constant channel count turns the division into a multiply the compiler can vectorize
+	switch (num_channels) {
+	case 1:
+		std::copy(input, input + length, output);
+		break;
+	case 2:
+		DownmixStereo(input, length, output);
+		break;
+	case 3:
+		DownmixFixed<3>(input, length, output);
+		break;
+	case 4:
+		DownmixFixed<4>(input, length, output);
+		break;
+	case 6:
+		DownmixFixed<6>(input, length, output);
+		break;
+	case 8:
+		DownmixFixed<8>(input, length, output);
+		break;
+	default:
+		for (size_t i = 0; i < length; i++) {
+			int32_t sum = 0;
+			for (int j = 0; j < num_channels; j++) {
+				sum += *input++;
+			}
+			output[i] = (int16_t)(sum / num_channels);
+		}
+		break;
+	}
+}
+
+int32_t ResampleDot(const int16_t *input, const int16_t *filter, int length) {
+	return Kernels().dot(input, filter, length);
+}
+
+void ResampleFixedPhase(const int16_t *input, size_t step, const int16_t *filter, int length, int16_t *output, size_t count) {
+	Kernels().fixed_phase(input, step, filter, length, output, count);
+}
+
+}; // namespace chromaprint
+
+extern "C" int chromaprint_resample_dot(const short *src, const short *filter, int length)
+{
+	return chromaprint::ResampleDot(src, filter, length);
+}
+
+extern "C" void chromaprint_resample_fixed_phase(const short *src, int step, const short *filter, int length, short *dst, int count)
+{
+	chromaprint::ResampleFixedPhase(src, step, filter, length, dst, count);
+}
@@ -0,0 +1,28 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#ifndef CHROMAPRINT_AUDIO_KERNELS_H_
+#define CHROMAPRINT_AUDIO_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace chromaprint {
+
+// Loops AudioProcessor and the resampler spend their time in. Like the FFT kernels
+// they pick SSE2 or AVX2 code at startup and give exactly the plain loop's result.
+
+//! Averages interleaved stereo frames into length mono samples, rounding toward zero
+void DownmixStereo(const int16_t *input, size_t length, int16_t *output);
+
+//! Averages length frames of num_channels interleaved channels, rounding toward zero
+void DownmixMultiChannel(const int16_t *input, size_t length, int num_channels, int16_t *output);
+
+//! Sum of input[i] * filter[i] in 32 bit integers, the inner loop of av_resample
+int32_t ResampleDot(const int16_t *input, const int16_t *filter, int length);
+
+//! count outputs of av_resample with one filter phase, output k starts at input + k * step
+void ResampleFixedPhase(const int16_t *input, size_t step, const int16_t *filter, int length, int16_t *output, size_t count);
+
+}; // namespace chromaprint
+
+#endif
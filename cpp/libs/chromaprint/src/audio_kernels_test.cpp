@@ -0,0 +1,171 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <gtest/gtest.h>
+#include "audio_kernels.h"
+
+namespace chromaprint {
+
+namespace {
+
+// Deterministic noise, every few samples at the ends of the range
+struct Noise {
+	uint32_t state = 12345;
+	int16_t Next() {
+		state = state * 1103515245 + 12345;
+		switch ((state >> 8) % 8) {
+			case 0: return INT16_MIN;
+			case 1: return INT16_MAX;
+			default: return (int16_t) (state >> 16);
+		}
+	}
+};
+
+std::vector<int16_t> MakeSamples(size_t size, Noise &noise) {
+	std::vector<int16_t> samples(size);
+	for (size_t i = 0; i < size; i++) {
+		samples[i] = noise.Next();
+	}
+	return samples;
+}
+
+int16_t Downmix(const int16_t *input, int num_channels) {
+	int32_t sum = 0;
+	for (int i = 0; i < num_channels; i++) {
+		sum += input[i];
+	}
+	return (int16_t) (sum / num_channels);
+}
+
+int32_t Dot(const int16_t *input, const int16_t *filter, int length) {
+	int32_t sum = 0;
+	for (int i = 0; i < length; i++) {
+		sum += input[i] * (int32_t) filter[i];
+	}
+	return sum;
+}
+
+// av_resample rounding, filters are normalized to 1 << 15
+int16_t Round(int32_t val) {
+	val = (val + (1 << 14)) >> 15;
+	return (unsigned) (val + 32768) > 65535 ? (val >> 31) ^ 32767 : val;
+}
+
+// Filter taps small enough that a dot product of full scale samples stays in 32 bits
+std::vector<int16_t> MakeFilter(size_t size, Noise &noise) {
+	std::vector<int16_t> filter(size);
+	for (size_t i = 0; i < size; i++) {
+		filter[i] = noise.Next() / 128;
+	}
+	return filter;
+}
+
+};
+
+// Sizes around every vector width, so both the vector loops and their tails run
+
+TEST(AudioKernelsTest, DownmixStereo) {
+	for (size_t length = 0; length <= 40; length++) {
+		Noise noise;
+		std::vector<int16_t> input = MakeSamples(2 * length, noise);
+		std::vector<int16_t> output(length);
+		DownmixStereo(input.data(), length, output.data());
+		for (size_t i = 0; i < length; i++) {
+			ASSERT_EQ(Downmix(&input[2 * i], 2), output[i]) << "length " << length << " index " << i;
+		}
+	}
+}
+
+TEST(AudioKernelsTest, DownmixMultiChannel) {
+	for (int num_channels = 1; num_channels <= 9; num_channels++) {
+		for (size_t length = 0; length <= 20; length++) {
+			Noise noise;
+			std::vector<int16_t> input = MakeSamples(num_channels * length, noise);
+			std::vector<int16_t> output(length);
+			DownmixMultiChannel(input.data(), length, num_channels, output.data());
+			for (size_t i = 0; i < length; i++) {
+				ASSERT_EQ(Downmix(&input[num_channels * i], num_channels), output[i]) << "channels " << num_channels << " length " << length << " index " << i;
+			}
+		}
+	}
+}
+
+TEST(AudioKernelsTest, ResampleDot) {
+	for (int length = 0; length <= 100; length++) {
+		Noise noise;
+		std::vector<int16_t> input = MakeSamples(length, noise);
+		std::vector<int16_t> filter = MakeFilter(length, noise);
+		ASSERT_EQ(Dot(input.data(), filter.data(), length), ResampleDot(input.data(), filter.data(), length)) << "length " << length;
+	}
+}
+
+TEST(AudioKernelsTest, ResampleFixedPhase) {
+	for (int length = 1; length <= 40; length += 3) {
+		for (size_t step = 1; step <= 5; step++) {
+			const size_t count = 30;
+			Noise noise;
+			std::vector<int16_t> input = MakeSamples(count * step + length, noise);
+			std::vector<int16_t> filter = MakeFilter(length, noise);
+			std::vector<int16_t> output(count);
+			ResampleFixedPhase(input.data(), step, filter.data(), length, output.data(), count);
+			for (size_t i = 0; i < count; i++) {
+				ASSERT_EQ(Round(Dot(&input[i * step], filter.data(), length)), output[i]) << "length " << length << " step " << step << " index " << i;
+			}
+		}
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests, compares the kernels with the loops
+// AudioProcessor and av_resample used before on a second of 44.1 kHz stereo
+TEST(AudioKernelsTest, DISABLED_Benchmark) {
+	const size_t length = 44100;
+	const int iterations = 200;
+	// 44100 to 11025 Hz, av_resample_init makes 80 tap filters for it
+	const int taps = 80;
+	const size_t step = 4;
+	typedef std::chrono::steady_clock Clock;
+
+	Noise noise;
+	std::vector<int16_t> input = MakeSamples(2 * length, noise);
+	std::vector<int16_t> filter = MakeFilter(taps, noise);
+	std::vector<int16_t> mono(length);
+	std::vector<int16_t> resampled(length / step);
+	const size_t count = (length - taps) / step;
+
+	auto start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		for (size_t i = 0; i < length; i++) {
+			mono[i] = Downmix(&input[2 * i], 2);
+		}
+	}
+	const double downmix_loop = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+	start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		for (size_t i = 0; i < count; i++) {
+			resampled[i] = Round(Dot(&mono[i * step], filter.data(), taps));
+		}
+	}
+	const double resample_loop = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+	const int16_t check = resampled[count / 2];
+
+	start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		DownmixStereo(input.data(), length, mono.data());
+	}
+	const double downmix_kernel = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+	start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		ResampleFixedPhase(mono.data(), step, filter.data(), taps, resampled.data(), count);
+	}
+	const double resample_kernel = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+	ASSERT_EQ(check, resampled[count / 2]);
+	printf("downmix: loop %.0f us, kernel %.0f us\n", downmix_loop, downmix_kernel);
+	printf("resample to 11025 Hz: loop %.0f us, kernel %.0f us\n", resample_loop, resample_kernel);
+}
+
+}; // namespace chromaprint
@@ -3,12 +3,14 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <math.h>
 #include <stdio.h>
 extern "C" {
 #include "avresample/avcodec.h"
 }
 #include "debug.h"
 #include "audio_processor.h"
+#include "audio_kernels.h"
 
 namespace chromaprint {
 
@@ -49,23 +51,12 @@ void AudioProcessor::LoadMono(const int16_t *input, int length)
 
 void AudioProcessor::LoadStereo(const int16_t *input, int length)
 {
-	int16_t *output = m_buffer.data() + m_buffer_offset;
-	while (length--) {
-		*output++ = (input[0] + input[1]) / 2;
-		input += 2;
-	}
+	DownmixStereo(input, length, m_buffer.data() + m_buffer_offset);
 }
 
 void AudioProcessor::LoadMultiChannel(const int16_t *input, int length)
 {
-	int16_t *output = m_buffer.data() + m_buffer_offset;
-	while (length--) {
-		int32_t sum = 0;
-		for (int i = 0; i < m_num_channels; i++) {
-			sum += *input++;
-		}
-		*output++ = (int16_t)(sum / m_num_channels);
-	}
+	DownmixMultiChannel(input, length, m_num_channels, m_buffer.data() + m_buffer_offset);
 }
 
 int AudioProcessor::Load(const int16_t *input, int length)
@@ -147,6 +138,13 @@ void AudioProcessor::Consume(const int16_t *input, int length)
 	assert(length >= 0);
 	assert(length % m_num_channels == 0);
 	length /= m_num_channels;
+	if (!m_resample_ctx && m_num_channels == 1 && m_buffer_offset == 0) {
+		// Already in the target format, nothing to buffer
+		if (length > 0) {
+			m_consumer->Consume(input, length);
+		}
+		return;
+	}
 	while (length > 0) {
 		int consumed = Load(input, length); 
 		input += consumed * m_num_channels;
@@ -161,6 +159,39 @@ void AudioProcessor::Consume(const int16_t *input, int length)
 	}
 }
 
+bool AudioProcessor::GetRestartLimits(int sample_rate, int *warmup, int *block, int *lookahead) const
+{
+	if (sample_rate == m_target_sample_rate) {
+		*warmup = 0;
+		*block = 1;
+		*lookahead = 0;
+		return true;
+	}
+	// Same filter length as av_resample_init, the first output is centered on input sample 0
+	// and reads (filter_length - 1) / 2 samples before it
+	double factor = std::min(m_target_sample_rate * kResampleCutoff / sample_rate, 1.0);
+	int64_t filter_length = std::max((int)ceil(kResampleFilterLength / factor), 1);
+	int64_t history = (filter_length - 1) / 2;
+	*warmup = (int)((history * m_target_sample_rate + sample_rate - 1) / sample_rate);
+	// Resample() makes at most kMaxBufferSize samples from a full buffer. If that limit never
+	// kicks in, Flush() finishes the stream wherever it started, if it always does every block
+	// is exactly kMaxBufferSize samples long
+	int64_t max_output = (kMaxBufferSize - filter_length + 1 + history) * m_target_sample_rate / sample_rate + 1;
+	int64_t min_output = (kMaxBufferSize - filter_length) * m_target_sample_rate / sample_rate - 1;
+	if (max_output <= kMaxBufferSize) {
+		*block = 1;
+		*lookahead = (int)filter_length;
+		return true;
+	}
+	if (min_output >= kMaxBufferSize) {
+		// The last block can be cut short, anything a full buffer before the end never is
+		*block = kMaxBufferSize;
+		*lookahead = (int)filter_length + kMaxBufferSize;
+		return true;
+	}
+	return false;
+}
+
 void AudioProcessor::Flush()
 {
 	if (m_buffer_offset) {
@@ -48,6 +48,14 @@ namespace chromaprint
 		//! Process any buffered input that was not processed before and clear buffers
 		void Flush();
 
+		//! Describe how the output for a stream at sample_rate depends on where the stream starts.
+		//! The first warmup output samples are made from mirrored input, and the output comes in
+		//! blocks of block samples that only match another stream's if they start on the same block.
+		//! An output sample is only complete once lookahead more input samples have been consumed,
+		//! and a restart only matches if the whole stream goes on for lookahead samples after it.
+		//! Returns false if the block boundaries depend on the whole stream.
+		bool GetRestartLimits(int sample_rate, int *warmup, int *block, int *lookahead) const;
+
 	private:
 		CHROMAPRINT_DISABLE_COPY(AudioProcessor);
 
@@ -81,6 +81,10 @@ void av_resample_compensate(struct AVResampleContext *c, int sample_delta, int c
 void av_resample_close(struct AVResampleContext *c);
 void av_build_filter(int16_t *filter, double factor, int tap_count, int phase_count, int scale, int type);
 
+/* Vector inner loops of av_resample for 16 bit filters, in audio_kernels.cpp */
+int chromaprint_resample_dot(const short *src, const short *filter, int length);
+void chromaprint_resample_fixed_phase(const short *src, int step, const short *filter, int length, short *dst, int count);
+
 /* error handling */
 #if EDOM > 0
 #define AVERROR(e) (-(e))   ///< Returns a negative error code from a POSIX error code, to return from library functions.
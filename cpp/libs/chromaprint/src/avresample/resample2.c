@@ -236,6 +236,12 @@ int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int
     int dst_incr_frac= c->dst_incr % c->src_incr;
     int dst_incr=      c->dst_incr / c->src_incr;
     int compensation_distance= c->compensation_distance;
+#ifndef CONFIG_RESAMPLE_HP
+    /* integer decimation, every output uses the same filter phase and the input
+       moves by a whole number of samples */
+    int fixed_phase= !c->linear && compensation_distance == 0 && dst_incr_frac == 0 &&
+                     dst_incr > c->phase_mask && !(dst_incr & c->phase_mask);
+#endif
 
   if(compensation_distance == 0 && c->filter_length == 1 && c->phase_shift==0){
         int64_t index2= ((int64_t)index)<<32;
@@ -256,6 +262,18 @@ int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int
         int sample_index= index >> c->phase_shift;
         FELEM2 val=0;
 
+#ifndef CONFIG_RESAMPLE_HP
+        if(fixed_phase && sample_index >= 0){
+            int count= 0;
+            if(sample_index + c->filter_length <= src_size)
+                count= FFMIN(dst_size - dst_index, (src_size - c->filter_length - sample_index) / (dst_incr >> c->phase_shift) + 1);
+            chromaprint_resample_fixed_phase(src + sample_index, dst_incr >> c->phase_shift, filter, c->filter_length, dst + dst_index, count);
+            dst_index += count;
+            index += count * dst_incr;
+            break;
+        }
+#endif
+
         if(sample_index < 0){
             for(i=0; i<c->filter_length; i++)
                 val += src[FFABS(sample_index + i) % src_size] * filter[i];
@@ -269,9 +287,13 @@ int av_resample(AVResampleContext *c, short *dst, short *src, int *consumed, int
             }
             val+=(v2-val)*(FELEML)frac / c->src_incr;
         }else{
+#ifndef CONFIG_RESAMPLE_HP
+            val = chromaprint_resample_dot(src + sample_index, filter, c->filter_length);
+#else
             for(i=0; i<c->filter_length; i++){
                 val += src[sample_index + i] * (FELEM2)filter[i];
             }
+#endif
         }
 
 #ifdef CONFIG_RESAMPLE_AUDIOPHILE_KIDDY_MODE
@@ -1,8 +1,10 @@
 // Copyright (C) 2010-2016  Lukas Lalinsky
 // Distributed under the MIT license, see the LICENSE file for details.
 
+#include <algorithm>
 #include <limits>
 #include <cmath>
+#include <utility>
 #include "fft_frame.h"
 #include "utils.h"
 #include "chroma.h"
@@ -21,7 +23,6 @@ Chroma::Chroma(int min_freq, int max_freq, int frame_size, int sample_rate, Feat
 	: m_interpolate(false),
 	  m_notes(frame_size),
 	  m_notes_frac(frame_size),
-	  m_features(NUM_BANDS),
 	  m_consumer(consumer)
 {
 	PrepareNotes(min_freq, max_freq, frame_size, sample_rate);
@@ -42,18 +43,14 @@ void Chroma::PrepareNotes(int min_freq, int max_freq, int frame_size, int sample
 		m_notes[i] = (char)note;
 		m_notes_frac[i] = note - m_notes[i];
 	}
+	PrepareSchedule();
 }
 
-void Chroma::Reset()
-{
-}
-
-void Chroma::Consume(const FFTFrame &frame)
+void Chroma::PrepareSchedule()
 {
-	fill(m_features.begin(), m_features.end(), 0.0);
+	std::vector<std::vector<std::pair<int, double>>> bands(NUM_BANDS);
 	for (int i = m_min_index; i < m_max_index; i++) {
 		int note = m_notes[i];
-		double energy = frame[i];
 		if (m_interpolate) {
 			int note2 = note;
 			double a = 1.0;
@@ -65,14 +62,51 @@ void Chroma::Consume(const FFTFrame &frame)
 				note2 = (note + 1) % NUM_BANDS;
 				a = 1.5 - m_notes_frac[i];
 			}
-			m_features[note] += energy * a; 
-			m_features[note2] += energy * (1.0 - a); 
+			bands[note].push_back(std::make_pair(i, a));
+			// A bin right in the middle of its band gives nothing to a neighbour
+			if (note2 != note) {
+				bands[note2].push_back(std::make_pair(i, 1.0 - a));
+			}
 		}
 		else {
-			m_features[note] += energy; 
+			bands[note].push_back(std::make_pair(i, 1.0));
+		}
+	}
+
+	m_num_steps = 0;
+	for (int b = 0; b < NUM_BANDS; b++) {
+		m_num_steps = std::max(m_num_steps, int(bands[b].size()));
+	}
+	// Bands with fewer bins are padded with zero weights, which leave their sums as they are.
+	// The bins of a band repeat in every octave, so all bands have about as many.
+	m_bins.assign(m_num_steps * NUM_BANDS, m_min_index);
+	m_weights.assign(m_num_steps * NUM_BANDS, 0.0);
+	for (int b = 0; b < NUM_BANDS; b++) {
+		for (size_t s = 0; s < bands[b].size(); s++) {
+			m_bins[s * NUM_BANDS + b] = bands[b][s].first;
+			m_weights[s * NUM_BANDS + b] = bands[b][s].second;
+		}
+	}
+}
+
+void Chroma::Reset()
+{
+}
+
+void Chroma::Consume(const FFTFrame &frame)
+{
+	Real features[NUM_BANDS] = { 0.0 };
+	const Real *energy = frame.data();
+	const int *bins = m_bins.data();
+	const Real *weights = m_weights.data();
+	for (int s = 0; s < m_num_steps; s++) {
+		for (int b = 0; b < NUM_BANDS; b++) {
+			features[b] += energy[bins[b]] * weights[b];
 		}
+		bins += NUM_BANDS;
+		weights += NUM_BANDS;
 	}
-	m_consumer->Consume(m_features);
+	m_consumer->Consume(FeatureSpan(features, NUM_BANDS));
 }
 
 }; // namespace chromaprint
@@ -23,6 +23,7 @@ public:
 
 	void set_interpolate(bool interpolate) {
 		m_interpolate = interpolate;
+		PrepareSchedule();
 	}
 
 	void Reset();
@@ -32,13 +33,19 @@ private:
 	CHROMAPRINT_DISABLE_COPY(Chroma);
 
 	void PrepareNotes(int min_freq, int max_freq, int frame_size, int sample_rate);
+	void PrepareSchedule();
 
 	bool m_interpolate;
 	std::vector<char> m_notes;
 	std::vector<double> m_notes_frac;
 	int m_min_index;
 	int m_max_index;
-	std::vector<double> m_features;
+	// Step s of the schedule adds frame[m_bins[s * NUM_BANDS + b]] * m_weights[s * NUM_BANDS + b]
+	// to band b. Every band gets its bins in the same order as a scatter over the bins
+	// would give them, but the bands don't wait on each other.
+	int m_num_steps;
+	std::vector<int> m_bins;
+	std::vector<Real> m_weights;
 	FeatureVectorConsumer *m_consumer;
 };
 
@@ -12,12 +12,11 @@ namespace chromaprint {
 ChromaFilter::ChromaFilter(const double *coefficients, int length, FeatureVectorConsumer *consumer)
 	: m_coefficients(coefficients),
 	  m_length(length),
-	  m_buffer(8),
-	  m_result(12),
 	  m_buffer_offset(0),
 	  m_buffer_size(1),
 	  m_consumer(consumer)
 {
+	assert(length <= kMaxLength);
 }
 
 ChromaFilter::~ChromaFilter()
@@ -30,19 +29,24 @@ void ChromaFilter::Reset()
 	m_buffer_offset = 0;
 }
 
-void ChromaFilter::Consume(std::vector<double> &features)
+void ChromaFilter::Consume(FeatureSpan features)
 {
-	m_buffer[m_buffer_offset] = features;
-	m_buffer_offset = (m_buffer_offset + 1) % 8;
+	assert(features.size() >= (size_t) kNumColumns);
+	std::copy(features.begin(), features.begin() + kNumColumns, &m_buffer[m_buffer_offset * kNumColumns]);
+	std::copy(features.begin(), features.begin() + kNumColumns, &m_buffer[(m_buffer_offset + kMaxLength) * kNumColumns]);
+	const Real *rows = &m_buffer[(m_buffer_offset + kMaxLength + 1 - m_length) * kNumColumns];
+	if (++m_buffer_offset == kMaxLength) {
+		m_buffer_offset = 0;
+	}
 	if (m_buffer_size >= m_length) {
-		int offset = (m_buffer_offset + 8 - m_length) % 8;
-		fill(m_result.begin(), m_result.end(), 0.0);
-		for (int i = 0; i < 12; i++) {
+		for (int i = 0; i < kNumColumns; i++) {
+			Real sum = 0.0;
 			for (int j = 0; j < m_length; j++) {
-				m_result[i] += m_buffer[(offset + j) % 8][i] * m_coefficients[j];
+				sum += rows[j * kNumColumns + i] * m_coefficients[j];
 			}
+			m_result[i] = sum;
 		}
-		m_consumer->Consume(m_result);
+		m_consumer->Consume(FeatureSpan(m_result.data(), m_result.size()));
 	}
 	else {
 		m_buffer_size++;
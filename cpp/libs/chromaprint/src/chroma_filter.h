@@ -4,7 +4,7 @@
 #ifndef CHROMAPRINT_CHROMA_FILTER_H_
 #define CHROMAPRINT_CHROMA_FILTER_H_
 
-#include <vector>
+#include <array>
 #include "feature_vector_consumer.h"
 
 namespace chromaprint {
@@ -15,16 +15,21 @@ public:
 	~ChromaFilter();
 
 	void Reset();
-	void Consume(std::vector<double> &features);
+	void Consume(FeatureSpan features);
 
 	FeatureVectorConsumer *consumer() { return m_consumer; }
 	void set_consumer(FeatureVectorConsumer *consumer) { m_consumer = consumer; }
 
 private:
+	static const int kNumColumns = 12;
+	static const int kMaxLength = 8;
+
 	const double *m_coefficients;
 	int m_length;
-	std::vector< std::vector<double> > m_buffer;
-	std::vector<double> m_result;
+	// Every row is stored twice, kMaxLength rows apart, so the last m_length rows
+	// are always contiguous and the filter never wraps around
+	std::array<Real, 2 * kMaxLength * kNumColumns> m_buffer;
+	std::array<Real, kNumColumns> m_result;
 	int m_buffer_offset;
 	int m_buffer_size;
 	FeatureVectorConsumer *m_consumer;
@@ -17,10 +17,13 @@ public:
 	~ChromaNormalizer() {}
 	void Reset() {}
 
-	void Consume(std::vector<double> &features)
+	FeatureVectorConsumer *consumer() const { return m_consumer; }
+	void set_consumer(FeatureVectorConsumer *consumer) { m_consumer = consumer; }
+
+	void Consume(FeatureSpan features)
 	{
 		NormalizeVector(features.begin(), features.end(),
-						chromaprint::EuclideanNorm<std::vector<double>::iterator>,
+						chromaprint::EuclideanNorm<Real *>,
 						0.01);
 		m_consumer->Consume(features);
 	}
@@ -10,11 +10,11 @@
 namespace chromaprint {
 
 ChromaResampler::ChromaResampler(int factor, FeatureVectorConsumer *consumer)
-	: m_result(12, 0.0),
-	  m_iteration(0),
+	: m_iteration(0),
 	  m_factor(factor),
 	  m_consumer(consumer)
 {
+	m_result.fill(0.0);
 }
 
 ChromaResampler::~ChromaResampler()
@@ -24,10 +24,10 @@ ChromaResampler::~ChromaResampler()
 void ChromaResampler::Reset()
 {
 	m_iteration = 0;
-	fill(m_result.begin(), m_result.end(), 0.0);
+	m_result.fill(0.0);
 }
 
-void ChromaResampler::Consume(std::vector<double> &features)
+void ChromaResampler::Consume(FeatureSpan features)
 {
 	for (int i = 0; i < 12; i++) {
 		m_result[i] += features[i];
@@ -37,7 +37,7 @@ void ChromaResampler::Consume(std::vector<double> &features)
 		for (int i = 0; i < 12; i++) {
 			m_result[i] /= m_factor;
 		}
-		m_consumer->Consume(m_result);
+		m_consumer->Consume(FeatureSpan(m_result.data(), m_result.size()));
 		Reset();
 	}
 }
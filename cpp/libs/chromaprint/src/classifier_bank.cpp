@@ -0,0 +1,186 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#include "classifier_bank.h"
+#include "classifier.h"
+#include "filter_utils.h"
+#include "utils.h"
+
+namespace chromaprint {
+
+namespace {
+
+struct ClassifierParams {
+	int type;
+	int y;
+	int height;
+	int width;
+	double t0;
+	double t1;
+	double t2;
+};
+
+// Same values as kClassifiersTest1 and kClassifiersTest2 in fingerprinter_configuration.cpp.
+// FindSubfingerprintFunc compares them field by field, so a table changed on only one
+// side falls back to the generic loop instead of producing different fingerprints.
+
+struct ClassifiersTest1 {
+	static constexpr ClassifierParams kParams[16] = {
+		{ 0, 0, 3, 15, 2.10543, 2.45354, 2.69414 },
+		{ 1, 0, 4, 14, -0.345922, 0.0463746, 0.446251 },
+		{ 1, 4, 4, 11, -0.392132, 0.0291077, 0.443391 },
+		{ 3, 0, 4, 14, -0.192851, 0.00583535, 0.204053 },
+		{ 2, 8, 2, 4, -0.0771619, -0.00991999, 0.0575406 },
+		{ 5, 6, 2, 15, -0.710437, -0.518954, -0.330402 },
+		{ 1, 9, 2, 16, -0.353724, -0.0189719, 0.289768 },
+		{ 3, 4, 2, 10, -0.128418, -0.0285697, 0.0591791 },
+		{ 3, 9, 2, 16, -0.139052, -0.0228468, 0.0879723 },
+		{ 2, 1, 3, 6, -0.133562, 0.00669205, 0.155012 },
+		{ 3, 3, 6, 2, -0.0267, 0.00804829, 0.0459773 },
+		{ 2, 8, 1, 10, -0.0972417, 0.0152227, 0.129003 },
+		{ 3, 4, 4, 14, -0.141434, 0.00374515, 0.149935 },
+		{ 5, 4, 2, 15, -0.64035, -0.466999, -0.285493 },
+		{ 5, 9, 2, 3, -0.322792, -0.254258, -0.174278 },
+		{ 2, 1, 8, 4, -0.0741375, -0.00590933, 0.0600357 },
+	};
+};
+
+// Also the table of TEST3, TEST4 and TEST5
+struct ClassifiersTest2 {
+	static constexpr ClassifierParams kParams[16] = {
+		{ 0, 4, 3, 15, 1.98215, 2.35817, 2.63523 },
+		{ 4, 4, 6, 15, -1.03809, -0.651211, -0.282167 },
+		{ 1, 0, 4, 16, -0.298702, 0.119262, 0.558497 },
+		{ 3, 8, 2, 12, -0.105439, 0.0153946, 0.135898 },
+		{ 3, 4, 4, 8, -0.142891, 0.0258736, 0.200632 },
+		{ 4, 0, 3, 5, -0.826319, -0.590612, -0.368214 },
+		{ 1, 2, 2, 9, -0.557409, -0.233035, 0.0534525 },
+		{ 2, 7, 3, 4, -0.0646826, 0.00620476, 0.0784847 },
+		{ 2, 6, 2, 16, -0.192387, -0.029699, 0.215855 },
+		{ 2, 1, 3, 2, -0.0397818, -0.00568076, 0.0292026 },
+		{ 5, 10, 1, 15, -0.53823, -0.369934, -0.190235 },
+		{ 3, 6, 2, 10, -0.124877, 0.0296483, 0.139239 },
+		{ 2, 1, 1, 14, -0.101475, 0.0225617, 0.231971 },
+		{ 3, 5, 6, 4, -0.0799915, -0.00729616, 0.063262 },
+		{ 1, 9, 2, 12, -0.272556, 0.019424, 0.302559 },
+		{ 3, 4, 2, 14, -0.164292, -0.0321188, 0.0846339 },
+	};
+};
+
+constexpr ClassifierParams ClassifiersTest1::kParams[16];
+constexpr ClassifierParams ClassifiersTest2::kParams[16];
+
+constexpr size_t kNumClassifiers = 16;
+
+constexpr int MaxWidth(const ClassifierParams *params, size_t count, int width = 0) {
+	return count == 0 ? width : MaxWidth(params + 1, count - 1, params[0].width > width ? params[0].width : width);
+}
+
+// The rows a filter at offset x can touch, fetched once per subfingerprint. Same
+// arithmetic as RollingIntegralImage::Area for r1 > 0, with rows relative to x.
+class RowWindow {
+public:
+	explicit RowWindow(const double **rows) : m_rows(rows) {}
+
+	double Area(size_t r1, size_t c1, size_t r2, size_t c2) const {
+		if (r1 == r2 || c1 == c2) {
+			return 0.0;
+		}
+		const double *row1 = m_rows[r1];
+		const double *row2 = m_rows[r2];
+		if (c1 == 0) {
+			return row2[c2 - 1] - row1[c2 - 1];
+		} else {
+			return row2[c2 - 1] - row1[c2 - 1] - row2[c1 - 1] + row1[c1 - 1];
+		}
+	}
+
+private:
+	const double **m_rows;
+};
+
+template <int Type> struct FixedFilter;
+
+template <> struct FixedFilter<0> {
+	static double Apply(const RowWindow &rows, size_t y, size_t w, size_t h) { return Filter0(rows, 0, y, w, h, SubtractLog); }
+};
+
+template <> struct FixedFilter<1> {
+	static double Apply(const RowWindow &rows, size_t y, size_t w, size_t h) { return Filter1(rows, 0, y, w, h, SubtractLog); }
+};
+
+template <> struct FixedFilter<2> {
+	static double Apply(const RowWindow &rows, size_t y, size_t w, size_t h) { return Filter2(rows, 0, y, w, h, SubtractLog); }
+};
+
+template <> struct FixedFilter<3> {
+	static double Apply(const RowWindow &rows, size_t y, size_t w, size_t h) { return Filter3(rows, 0, y, w, h, SubtractLog); }
+};
+
+template <> struct FixedFilter<4> {
+	static double Apply(const RowWindow &rows, size_t y, size_t w, size_t h) { return Filter4(rows, 0, y, w, h, SubtractLog); }
+};
+
+template <> struct FixedFilter<5> {
+	static double Apply(const RowWindow &rows, size_t y, size_t w, size_t h) { return Filter5(rows, 0, y, w, h, SubtractLog); }
+};
+
+// Unrolls the table, every filter shape and threshold is a constant the compiler folds
+template <typename Table, size_t I>
+struct FixedBank {
+	static uint32_t Apply(const RowWindow &rows, uint32_t bits) {
+		static_assert(Table::kParams[I].type >= 0 && Table::kParams[I].type <= 5, "unknown filter type");
+		const double value = FixedFilter<Table::kParams[I].type>::Apply(rows,
+			Table::kParams[I].y, Table::kParams[I].width, Table::kParams[I].height);
+		const Quantizer quantizer(Table::kParams[I].t0, Table::kParams[I].t1, Table::kParams[I].t2);
+		bits = (bits << 2) | GrayCode(quantizer.Quantize(value));
+		return FixedBank<Table, I + 1>::Apply(rows, bits);
+	}
+};
+
+template <typename Table>
+struct FixedBank<Table, kNumClassifiers> {
+	static uint32_t Apply(const RowWindow &, uint32_t bits) {
+		return bits;
+	}
+};
+
+template <typename Table>
+uint32_t CalculateSubfingerprint(const RollingIntegralImage &image, size_t offset) {
+	const size_t num_rows = MaxWidth(Table::kParams, kNumClassifiers) + 1;
+	const double *rows[num_rows];
+	image.GetRows(offset - 1, num_rows, rows);
+	return FixedBank<Table, 0>::Apply(RowWindow(rows), 0);
+}
+
+template <typename Table>
+bool Matches(const Classifier *classifiers, size_t num_classifiers) {
+	if (num_classifiers != kNumClassifiers) {
+		return false;
+	}
+	for (size_t i = 0; i < kNumClassifiers; i++) {
+		const ClassifierParams &params = Table::kParams[i];
+		const Filter &filter = classifiers[i].filter();
+		const Quantizer &quantizer = classifiers[i].quantizer();
+		if (filter.type() != params.type || filter.y() != params.y ||
+			filter.height() != params.height || filter.width() != params.width ||
+			quantizer.t0() != params.t0 || quantizer.t1() != params.t1 || quantizer.t2() != params.t2) {
+			return false;
+		}
+	}
+	return true;
+}
+
+};
+
+SubfingerprintFunc FindSubfingerprintFunc(const Classifier *classifiers, size_t num_classifiers)
+{
+	if (Matches<ClassifiersTest1>(classifiers, num_classifiers)) {
+		return CalculateSubfingerprint<ClassifiersTest1>;
+	}
+	if (Matches<ClassifiersTest2>(classifiers, num_classifiers)) {
+		return CalculateSubfingerprint<ClassifiersTest2>;
+	}
+	return 0;
+}
+
+}; // namespace chromaprint
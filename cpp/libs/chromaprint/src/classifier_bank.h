@@ -0,0 +1,24 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#ifndef CHROMAPRINT_CLASSIFIER_BANK_H_
+#define CHROMAPRINT_CLASSIFIER_BANK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "utils/rolling_integral_image.h"
+
+namespace chromaprint {
+
+class Classifier;
+
+//! Calculates the subfingerprint at offset with one classifier table compiled in
+typedef uint32_t (*SubfingerprintFunc)(const RollingIntegralImage &image, size_t offset);
+
+//! Returns the specialized bank for the classifier tables of the built-in
+//! configurations, or 0 if the classifiers don't exactly match any of them.
+//! The banks need offset > 0, the first subfingerprint has to use the classifiers.
+SubfingerprintFunc FindSubfingerprintFunc(const Classifier *classifiers, size_t num_classifiers);
+
+}; // namespace chromaprint
+
+#endif
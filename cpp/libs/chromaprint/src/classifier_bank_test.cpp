@@ -0,0 +1,104 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <gtest/gtest.h>
+#include "classifier.h"
+#include "classifier_bank.h"
+#include "fingerprinter_configuration.h"
+#include "utils.h"
+
+namespace chromaprint {
+
+namespace {
+
+const int kNumRows = 600;
+
+// Normalized chroma like rows, the integral image keeps a 257 row window of them
+RollingIntegralImage MakeImage() {
+	RollingIntegralImage image(256);
+	uint32_t state = 12345;
+	std::vector<Real> row(12);
+	for (int i = 0; i < kNumRows; i++) {
+		for (size_t j = 0; j < row.size(); j++) {
+			state = state * 1103515245 + 12345;
+			row[j] = (state >> 16) / 65536.0;
+		}
+		NormalizeVector(row.begin(), row.end(), EuclideanNorm<std::vector<Real>::iterator>, 0.01);
+		image.AddRow(row);
+	}
+	return image;
+}
+
+uint32_t GenericSubfingerprint(const FingerprinterConfiguration &config, const RollingIntegralImage &image, size_t offset) {
+	uint32_t bits = 0;
+	for (int i = 0; i < config.num_classifiers(); i++) {
+		bits = (bits << 2) | GrayCode(config.classifiers()[i].Classify(image, offset));
+	}
+	return bits;
+}
+
+};
+
+template <typename Config>
+void CheckBank(const RollingIntegralImage &image) {
+	Config config;
+	SubfingerprintFunc calculate = FindSubfingerprintFunc(config.classifiers(), config.num_classifiers());
+	ASSERT_TRUE(calculate != 0);
+	for (size_t offset = kNumRows - 240; offset + config.max_filter_width() <= kNumRows; offset++) {
+		ASSERT_EQ(GenericSubfingerprint(config, image, offset), calculate(image, offset)) << "offset " << offset;
+	}
+}
+
+TEST(ClassifierBankTest, MatchesClassifiers) {
+	const RollingIntegralImage image = MakeImage();
+	CheckBank<FingerprinterConfigurationTest1>(image);
+	CheckBank<FingerprinterConfigurationTest2>(image);
+	CheckBank<FingerprinterConfigurationTest3>(image);
+	CheckBank<FingerprinterConfigurationTest4>(image);
+	CheckBank<FingerprinterConfigurationTest5>(image);
+}
+
+TEST(ClassifierBankTest, OtherClassifiers) {
+	FingerprinterConfigurationTest2 config;
+	std::vector<Classifier> classifiers(config.classifiers(), config.classifiers() + config.num_classifiers());
+	EXPECT_TRUE(FindSubfingerprintFunc(classifiers.data(), classifiers.size() - 1) == 0);
+	classifiers[7] = Classifier(classifiers[7].filter(), Quantizer(-0.1, 0.0, 0.1));
+	EXPECT_TRUE(FindSubfingerprintFunc(classifiers.data(), classifiers.size()) == 0);
+}
+
+// Run with --gtest_also_run_disabled_tests, compares the bank with the classifier loop
+TEST(ClassifierBankTest, DISABLED_Benchmark) {
+	const RollingIntegralImage image = MakeImage();
+	const int iterations = 200;
+	typedef std::chrono::steady_clock Clock;
+
+	FingerprinterConfigurationTest2 config;
+	SubfingerprintFunc calculate = FindSubfingerprintFunc(config.classifiers(), config.num_classifiers());
+	const size_t first = kNumRows - 240;
+	const size_t last = kNumRows - config.max_filter_width();
+
+	uint32_t generic_check = 0;
+	auto start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		for (size_t offset = first; offset <= last; offset++) {
+			generic_check ^= GenericSubfingerprint(config, image, offset);
+		}
+	}
+	const double generic = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (iterations * (last - first + 1));
+
+	uint32_t bank_check = 0;
+	start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		for (size_t offset = first; offset <= last; offset++) {
+			bank_check ^= calculate(image, offset);
+		}
+	}
+	const double bank = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (iterations * (last - first + 1));
+
+	ASSERT_EQ(generic_check, bank_check);
+	printf("subfingerprint: classifiers %.0f ns, bank %.0f ns\n", generic, bank);
+}
+
+}; // namespace chromaprint
@@ -4,14 +4,36 @@
 #ifndef CHROMAPRINT_FEATURE_VECTOR_CONSUMER_H_
 #define CHROMAPRINT_FEATURE_VECTOR_CONSUMER_H_
 
+#include <stddef.h>
 #include <vector>
+#include "precision.h"
 
 namespace chromaprint {
 
+//! A row of features owned by whoever produced it, only valid during the Consume call.
+//! Producers keep their rows in fixed storage, so passing one on never allocates.
+class FeatureSpan {
+public:
+	FeatureSpan(Real *data, size_t size) : m_data(data), m_size(size) {}
+	FeatureSpan(std::vector<Real> &features) : m_data(features.data()), m_size(features.size()) {}
+
+	Real *data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+	Real *begin() const { return m_data; }
+	Real *end() const { return m_data + m_size; }
+
+	Real &operator[](size_t i) const { return m_data[i]; }
+
+private:
+	Real *m_data;
+	size_t m_size;
+};
+
 class FeatureVectorConsumer {
 public:
 	virtual ~FeatureVectorConsumer() {}
-	virtual void Consume(std::vector<double> &features) = 0;
+	virtual void Consume(FeatureSpan features) = 0;
 };
 
 }; // namespace chromaprint
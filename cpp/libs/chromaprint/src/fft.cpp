@@ -9,6 +9,22 @@
 
 namespace chromaprint {
 
+static FFTPlanning g_fft_planning = FFT_PLAN_ESTIMATE;
+static std::string g_fft_wisdom_file;
+
+void SetFFTPlanning(FFTPlanning planning, const std::string &wisdom_file) {
+	g_fft_planning = planning;
+	g_fft_wisdom_file = wisdom_file;
+}
+
+FFTPlanning GetFFTPlanning() {
+	return g_fft_planning;
+}
+
+std::string GetFFTWisdomFile() {
+	return g_fft_wisdom_file;
+}
+
 FFT::FFT(size_t frame_size, size_t overlap, FFTFrameConsumer *consumer)
 	: m_frame(1 + frame_size / 2), m_slicer(frame_size, frame_size - overlap), m_lib(new FFTLib(frame_size)), m_consumer(consumer) {}
 
@@ -6,6 +6,7 @@
 
 #include <cmath>
 #include <memory>
+#include <string>
 #include "utils.h"
 #include "fft_frame.h"
 #include "fft_frame_consumer.h"
@@ -16,6 +17,23 @@ namespace chromaprint {
 
 class FFTLib;
 
+//! How hard the FFT backend searches for a fast plan. Only FFTW makes a
+//! difference, the other backends have a single algorithm.
+enum FFTPlanning {
+	FFT_PLAN_ESTIMATE,
+	FFT_PLAN_MEASURE,
+	FFT_PLAN_PATIENT,
+};
+
+//! Sets the planning effort for FFTs created after the call. Plans are made once
+//! per frame size and shared by every FFT in the process. Measured plans take
+//! seconds to minutes to find, so with a wisdom file they are loaded from it and
+//! saved back, and only the first run for a frame size pays for the measurement.
+//! Wisdom from the file is used at any planning effort.
+void SetFFTPlanning(FFTPlanning planning, const std::string &wisdom_file = std::string());
+FFTPlanning GetFFTPlanning();
+std::string GetFFTWisdomFile();
+
 class FFT : public AudioConsumer
 {
 public:
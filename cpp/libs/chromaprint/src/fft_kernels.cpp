@@ -0,0 +1,332 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#include "fft_kernels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CHROMAPRINT_FFT_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace chromaprint {
+
+// The vector code below does the same multiplies and adds in the same order as
+// these loops, and never fuses them, so every backend gets identical spectra
+// whichever code the CPU runs.
+
+template <typename T>
+static void WindowScalar(const int16_t *input, size_t length, const T *window, T *output) {
+	for (size_t i = 0; i < length; i++) {
+		output[i] = input[i] * window[i];
+	}
+}
+
+template <typename T>
+static void HalfcomplexScalar(const T *input, size_t frame_size, size_t begin, Real *output) {
+	for (size_t i = begin; i < frame_size / 2; i++) {
+		output[i] = input[i] * input[i] + input[frame_size - i] * input[frame_size - i];
+	}
+}
+
+template <typename T>
+static void ComplexScalar(const T *input, size_t begin, size_t count, Real *output) {
+	for (size_t i = begin; i < count; i++) {
+		output[i] = input[2 * i] * input[2 * i] + input[2 * i + 1] * input[2 * i + 1];
+	}
+}
+
+static void SplitComplexScalar(const float *real, const float *imag, size_t begin, size_t count, Real *output) {
+	for (size_t i = begin; i < count; i++) {
+		output[i] = real[i] * real[i] + imag[i] * imag[i];
+	}
+}
+
+template <typename T>
+static void HalfcomplexPlain(const T *input, size_t frame_size, Real *output) {
+	HalfcomplexScalar(input, frame_size, 1, output);
+}
+
+template <typename T>
+static void ComplexPlain(const T *input, size_t count, Real *output) {
+	ComplexScalar(input, 0, count, output);
+}
+
+static void SplitComplexPlain(const float *real, const float *imag, size_t count, Real *output) {
+	SplitComplexScalar(real, imag, 0, count, output);
+}
+
+#ifdef CHROMAPRINT_FFT_KERNELS_X86
+
+// Stores a vector of results to the output, narrowing or widening it to Real
+
+__attribute__((target("sse2")))
+static inline void Store4(float *output, __m128 value) {
+	_mm_storeu_ps(output, value);
+}
+
+__attribute__((target("sse2")))
+static inline void Store4(double *output, __m128 value) {
+	_mm_storeu_pd(output, _mm_cvtps_pd(value));
+	_mm_storeu_pd(output + 2, _mm_cvtps_pd(_mm_movehl_ps(value, value)));
+}
+
+__attribute__((target("sse2")))
+static inline void Store2(float *output, __m128d value) {
+	_mm_storel_pi((__m64 *) output, _mm_cvtpd_ps(value));
+}
+
+__attribute__((target("sse2")))
+static inline void Store2(double *output, __m128d value) {
+	_mm_storeu_pd(output, value);
+}
+
+__attribute__((target("avx2")))
+static inline void Store8(float *output, __m256 value) {
+	_mm256_storeu_ps(output, value);
+}
+
+__attribute__((target("avx2")))
+static inline void Store8(double *output, __m256 value) {
+	_mm256_storeu_pd(output, _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+	_mm256_storeu_pd(output + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+}
+
+__attribute__((target("avx2")))
+static inline void Store4(float *output, __m256d value) {
+	_mm_storeu_ps(output, _mm256_cvtpd_ps(value));
+}
+
+__attribute__((target("avx2")))
+static inline void Store4(double *output, __m256d value) {
+	_mm256_storeu_pd(output, value);
+}
+
+__attribute__((target("sse2")))
+static void WindowSSE2(const int16_t *input, size_t length, const float *window, float *output) {
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		__m128i samples = _mm_loadu_si128((const __m128i *) (input + i));
+		// Sign extends by putting each sample in the top half and shifting it down
+		__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+		_mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low), _mm_loadu_ps(window + i)));
+		_mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), _mm_loadu_ps(window + i + 4)));
+	}
+	WindowScalar(input + i, length - i, window + i, output + i);
+}
+
+__attribute__((target("sse2")))
+static void WindowSSE2(const int16_t *input, size_t length, const double *window, double *output) {
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4) {
+		__m128i samples = _mm_loadl_epi64((const __m128i *) (input + i));
+		__m128i wide = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		_mm_storeu_pd(output + i, _mm_mul_pd(_mm_cvtepi32_pd(wide), _mm_loadu_pd(window + i)));
+		_mm_storeu_pd(output + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(wide, 8)), _mm_loadu_pd(window + i + 2)));
+	}
+	WindowScalar(input + i, length - i, window + i, output + i);
+}
+
+__attribute__((target("avx2")))
+static void WindowAVX2(const int16_t *input, size_t length, const float *window, float *output) {
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		__m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (input + i)));
+		_mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), _mm256_loadu_ps(window + i)));
+	}
+	WindowScalar(input + i, length - i, window + i, output + i);
+}
+
+__attribute__((target("avx2")))
+static void WindowAVX2(const int16_t *input, size_t length, const double *window, double *output) {
+	size_t i = 0;
+	for (; i + 4 <= length; i += 4) {
+		__m128i samples = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *) (input + i)));
+		_mm256_storeu_pd(output + i, _mm256_mul_pd(_mm256_cvtepi32_pd(samples), _mm256_loadu_pd(window + i)));
+	}
+	WindowScalar(input + i, length - i, window + i, output + i);
+}
+
+// The halfcomplex kernels load the imaginary parts as a block ending at frame_size - i
+// and reverse it, so lane k of both vectors belongs to bin i + k
+
+__attribute__((target("sse2")))
+static void HalfcomplexSSE2(const float *input, size_t frame_size, Real *output) {
+	size_t i = 1;
+	for (; i + 4 <= frame_size / 2; i += 4) {
+		__m128 real = _mm_loadu_ps(input + i);
+		__m128 imag = _mm_loadu_ps(input + frame_size - i - 3);
+		imag = _mm_shuffle_ps(imag, imag, _MM_SHUFFLE(0, 1, 2, 3));
+		Store4(output + i, _mm_add_ps(_mm_mul_ps(real, real), _mm_mul_ps(imag, imag)));
+	}
+	HalfcomplexScalar(input, frame_size, i, output);
+}
+
+__attribute__((target("sse2")))
+static void HalfcomplexSSE2(const double *input, size_t frame_size, Real *output) {
+	size_t i = 1;
+	for (; i + 2 <= frame_size / 2; i += 2) {
+		__m128d real = _mm_loadu_pd(input + i);
+		__m128d imag = _mm_loadu_pd(input + frame_size - i - 1);
+		imag = _mm_shuffle_pd(imag, imag, 1);
+		Store2(output + i, _mm_add_pd(_mm_mul_pd(real, real), _mm_mul_pd(imag, imag)));
+	}
+	HalfcomplexScalar(input, frame_size, i, output);
+}
+
+__attribute__((target("avx2")))
+static void HalfcomplexAVX2(const float *input, size_t frame_size, Real *output) {
+	const __m256i reverse = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	size_t i = 1;
+	for (; i + 8 <= frame_size / 2; i += 8) {
+		__m256 real = _mm256_loadu_ps(input + i);
+		__m256 imag = _mm256_permutevar8x32_ps(_mm256_loadu_ps(input + frame_size - i - 7), reverse);
+		Store8(output + i, _mm256_add_ps(_mm256_mul_ps(real, real), _mm256_mul_ps(imag, imag)));
+	}
+	HalfcomplexScalar(input, frame_size, i, output);
+}
+
+__attribute__((target("avx2")))
+static void HalfcomplexAVX2(const double *input, size_t frame_size, Real *output) {
+	size_t i = 1;
+	for (; i + 4 <= frame_size / 2; i += 4) {
+		__m256d real = _mm256_loadu_pd(input + i);
+		__m256d imag = _mm256_permute4x64_pd(_mm256_loadu_pd(input + frame_size - i - 3), _MM_SHUFFLE(0, 1, 2, 3));
+		Store4(output + i, _mm256_add_pd(_mm256_mul_pd(real, real), _mm256_mul_pd(imag, imag)));
+	}
+	HalfcomplexScalar(input, frame_size, i, output);
+}
+
+__attribute__((target("sse2")))
+static void ComplexSSE2(const float *input, size_t count, Real *output) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 a = _mm_loadu_ps(input + 2 * i);
+		__m128 b = _mm_loadu_ps(input + 2 * i + 4);
+		__m128 real = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 imag = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		Store4(output + i, _mm_add_ps(_mm_mul_ps(real, real), _mm_mul_ps(imag, imag)));
+	}
+	ComplexScalar(input, i, count, output);
+}
+
+__attribute__((target("avx2")))
+static void ComplexAVX2(const float *input, size_t count, Real *output) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 a = _mm256_loadu_ps(input + 2 * i);
+		__m256 b = _mm256_loadu_ps(input + 2 * i + 8);
+		// Shuffles stay inside 128 bit lanes, which leaves the bins in the order 0 1 4 5 2 3 6 7
+		__m256 real = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 imag = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 power = _mm256_add_ps(_mm256_mul_ps(real, real), _mm256_mul_ps(imag, imag));
+		power = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(power), _MM_SHUFFLE(3, 1, 2, 0)));
+		Store8(output + i, power);
+	}
+	ComplexScalar(input, i, count, output);
+}
+
+__attribute__((target("sse2")))
+static void SplitComplexSSE2(const float *real, const float *imag, size_t count, Real *output) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 re = _mm_loadu_ps(real + i);
+		__m128 im = _mm_loadu_ps(imag + i);
+		Store4(output + i, _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+	}
+	SplitComplexScalar(real, imag, i, count, output);
+}
+
+__attribute__((target("avx2")))
+static void SplitComplexAVX2(const float *real, const float *imag, size_t count, Real *output) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 re = _mm256_loadu_ps(real + i);
+		__m256 im = _mm256_loadu_ps(imag + i);
+		Store8(output + i, _mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im)));
+	}
+	SplitComplexScalar(real, imag, i, count, output);
+}
+
+#endif
+
+struct FFTKernels {
+	void (*window_float)(const int16_t *, size_t, const float *, float *);
+	void (*window_double)(const int16_t *, size_t, const double *, double *);
+	void (*halfcomplex_float)(const float *, size_t, Real *);
+	void (*halfcomplex_double)(const double *, size_t, Real *);
+	void (*complex_float)(const float *, size_t, Real *);
+	void (*split_complex)(const float *, const float *, size_t, Real *);
+};
+
+static FFTKernels PickKernels() {
+	FFTKernels kernels = {
+		WindowScalar<float>, WindowScalar<double>,
+		HalfcomplexPlain<float>, HalfcomplexPlain<double>,
+		ComplexPlain<float>, SplitComplexPlain,
+	};
+#ifdef CHROMAPRINT_FFT_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		kernels.window_float = WindowAVX2;
+		kernels.window_double = WindowAVX2;
+		kernels.halfcomplex_float = HalfcomplexAVX2;
+		kernels.halfcomplex_double = HalfcomplexAVX2;
+		kernels.complex_float = ComplexAVX2;
+		kernels.split_complex = SplitComplexAVX2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		kernels.window_float = WindowSSE2;
+		kernels.window_double = WindowSSE2;
+		kernels.halfcomplex_float = HalfcomplexSSE2;
+		kernels.halfcomplex_double = HalfcomplexSSE2;
+		kernels.complex_float = ComplexSSE2;
+		kernels.split_complex = SplitComplexSSE2;
+	}
+#endif
+	return kernels;
+}
+
+// Picked on first use, so FFTs made while other translation units are still being
+// initialized get working kernels too
+static const FFTKernels &Kernels() {
+	static const FFTKernels kernels = PickKernels();
+	return kernels;
+}
+
+void WindowFrame(const int16_t *b1, const int16_t *e1, const int16_t *b2, const int16_t *e2, const float *window, float *output) {
+	const size_t size1 = e1 - b1;
+	Kernels().window_float(b1, size1, window, output);
+	Kernels().window_float(b2, e2 - b2, window + size1, output + size1);
+}
+
+void WindowFrame(const int16_t *b1, const int16_t *e1, const int16_t *b2, const int16_t *e2, const double *window, double *output) {
+	const size_t size1 = e1 - b1;
+	Kernels().window_double(b1, size1, window, output);
+	Kernels().window_double(b2, e2 - b2, window + size1, output + size1);
+}
+
+void HalfcomplexPowerSpectrum(const float *input, size_t frame_size, Real *output) {
+	output[0] = input[0] * input[0];
+	output[frame_size / 2] = input[frame_size / 2] * input[frame_size / 2];
+	Kernels().halfcomplex_float(input, frame_size, output);
+}
+
+void HalfcomplexPowerSpectrum(const double *input, size_t frame_size, Real *output) {
+	output[0] = input[0] * input[0];
+	output[frame_size / 2] = input[frame_size / 2] * input[frame_size / 2];
+	Kernels().halfcomplex_double(input, frame_size, output);
+}
+
+void ComplexPowerSpectrum(const float *input, size_t count, Real *output) {
+	Kernels().complex_float(input, count, output);
+}
+
+void ComplexPowerSpectrum(const double *input, size_t count, Real *output) {
+	// Only kissfft built with double scalars gets here, which isn't worth a vector version
+	ComplexScalar(input, 0, count, output);
+}
+
+void SplitComplexPowerSpectrum(const float *real, const float *imag, size_t count, Real *output) {
+	Kernels().split_complex(real, imag, count, output);
+}
+
+}; // namespace chromaprint
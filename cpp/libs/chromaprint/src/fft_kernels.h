@@ -0,0 +1,33 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#ifndef CHROMAPRINT_FFT_KERNELS_H_
+#define CHROMAPRINT_FFT_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "precision.h"
+
+namespace chromaprint {
+
+// Loops shared by the FFTLib backends. Each one picks SSE2 or AVX2 code at startup
+// when the CPU has it, and gives bit for bit the same result as the plain loop.
+
+//! Converts the two parts of a frame the audio slicer handed out to floating point
+//! and multiplies them by the window
+void WindowFrame(const int16_t *begin1, const int16_t *end1, const int16_t *begin2, const int16_t *end2, const float *window, float *output);
+void WindowFrame(const int16_t *begin1, const int16_t *end1, const int16_t *begin2, const int16_t *end2, const double *window, double *output);
+
+//! Power spectrum of an FFTW R2HC frame, the imaginary part of bin i is at frame_size - i
+void HalfcomplexPowerSpectrum(const float *input, size_t frame_size, Real *output);
+void HalfcomplexPowerSpectrum(const double *input, size_t frame_size, Real *output);
+
+//! Power spectrum of count bins stored as interleaved real and imaginary parts
+void ComplexPowerSpectrum(const float *input, size_t count, Real *output);
+void ComplexPowerSpectrum(const double *input, size_t count, Real *output);
+
+//! Power spectrum of count bins stored as separate real and imaginary arrays
+void SplitComplexPowerSpectrum(const float *real, const float *imag, size_t count, Real *output);
+
+}; // namespace chromaprint
+
+#endif
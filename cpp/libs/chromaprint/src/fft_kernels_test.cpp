@@ -0,0 +1,163 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <gtest/gtest.h>
+#include "fft_kernels.h"
+#include "utils.h"
+
+namespace chromaprint {
+
+namespace {
+
+// Deterministic noise, small enough that squares stay well inside float range
+struct Noise {
+	uint32_t state = 12345;
+	int16_t Next() {
+		state = state * 1103515245 + 12345;
+		return (int16_t) (state >> 16);
+	}
+};
+
+template <typename T>
+std::vector<T> MakeWindow(size_t size) {
+	std::vector<T> window(size);
+	PrepareHammingWindow(window.begin(), window.end(), 1.0 / INT16_MAX);
+	return window;
+}
+
+template <typename T>
+std::vector<T> MakeSpectrum(size_t size, Noise &noise) {
+	std::vector<T> spectrum(size);
+	for (size_t i = 0; i < size; i++) {
+		spectrum[i] = noise.Next() / 64.0;
+	}
+	return spectrum;
+}
+
+template <typename T>
+void CheckWindow(size_t size, size_t split) {
+	Noise noise;
+	std::vector<int16_t> input(size);
+	for (size_t i = 0; i < size; i++) {
+		input[i] = noise.Next();
+	}
+	std::vector<T> window = MakeWindow<T>(size);
+	std::vector<T> output(size);
+	WindowFrame(input.data(), input.data() + split, input.data() + split, input.data() + size, window.data(), output.data());
+	for (size_t i = 0; i < size; i++) {
+		ASSERT_EQ(T(input[i] * window[i]), output[i]) << "size " << size << " split " << split << " index " << i;
+	}
+}
+
+template <typename T>
+void CheckHalfcomplex(size_t frame_size) {
+	Noise noise;
+	std::vector<T> input = MakeSpectrum<T>(frame_size, noise);
+	std::vector<Real> output(frame_size / 2 + 1);
+	HalfcomplexPowerSpectrum(input.data(), frame_size, output.data());
+	ASSERT_EQ(Real(input[0] * input[0]), output[0]);
+	ASSERT_EQ(Real(input[frame_size / 2] * input[frame_size / 2]), output[frame_size / 2]);
+	for (size_t i = 1; i < frame_size / 2; i++) {
+		ASSERT_EQ(Real(input[i] * input[i] + input[frame_size - i] * input[frame_size - i]), output[i]) << "frame size " << frame_size << " bin " << i;
+	}
+}
+
+template <typename T>
+void CheckComplex(size_t count) {
+	Noise noise;
+	std::vector<T> input = MakeSpectrum<T>(2 * count, noise);
+	std::vector<Real> output(count);
+	ComplexPowerSpectrum(input.data(), count, output.data());
+	for (size_t i = 0; i < count; i++) {
+		ASSERT_EQ(Real(input[2 * i] * input[2 * i] + input[2 * i + 1] * input[2 * i + 1]), output[i]) << "count " << count << " bin " << i;
+	}
+}
+
+};
+
+// Sizes around every vector width, so both the vector loops and their tails run
+
+TEST(FFTKernelsTest, WindowFrame) {
+	// A one sample Hamming window divides by zero
+	for (size_t size = 2; size <= 40; size++) {
+		for (size_t split = 0; split <= size; split += 3) {
+			CheckWindow<float>(size, split);
+			CheckWindow<double>(size, split);
+		}
+	}
+}
+
+TEST(FFTKernelsTest, HalfcomplexPowerSpectrum) {
+	for (size_t frame_size = 2; frame_size <= 48; frame_size++) {
+		CheckHalfcomplex<float>(frame_size);
+		CheckHalfcomplex<double>(frame_size);
+	}
+}
+
+TEST(FFTKernelsTest, ComplexPowerSpectrum) {
+	for (size_t count = 0; count <= 24; count++) {
+		CheckComplex<float>(count);
+		CheckComplex<double>(count);
+	}
+}
+
+TEST(FFTKernelsTest, SplitComplexPowerSpectrum) {
+	for (size_t count = 0; count <= 24; count++) {
+		Noise noise;
+		std::vector<float> real = MakeSpectrum<float>(count, noise);
+		std::vector<float> imag = MakeSpectrum<float>(count, noise);
+		std::vector<Real> output(count);
+		SplitComplexPowerSpectrum(real.data(), imag.data(), count, output.data());
+		for (size_t i = 0; i < count; i++) {
+			ASSERT_EQ(Real(real[i] * real[i] + imag[i] * imag[i]), output[i]) << "count " << count << " bin " << i;
+		}
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests, compares the kernels with the loops the
+// backends used before on the default 4096 sample frame
+TEST(FFTKernelsTest, DISABLED_Benchmark) {
+	const size_t frame_size = 4096;
+	const int iterations = 20000;
+	typedef std::chrono::steady_clock Clock;
+
+	Noise noise;
+	std::vector<int16_t> input(frame_size);
+	for (size_t i = 0; i < frame_size; i++) {
+		input[i] = noise.Next();
+	}
+	std::vector<double> window = MakeWindow<double>(frame_size);
+	std::vector<double> frame(frame_size);
+	std::vector<Real> spectrum(frame_size / 2 + 1);
+	const int16_t *begin = input.data();
+	const int16_t *half = begin + frame_size / 2;
+	const int16_t *end = begin + frame_size;
+
+	auto start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		auto window_it = window.begin();
+		auto frame_it = frame.begin();
+		ApplyWindow(begin, half, window_it, frame_it);
+		ApplyWindow(half, end, window_it, frame_it);
+		spectrum[0] = frame[0] * frame[0];
+		for (size_t i = 1; i < frame_size / 2; i++) {
+			spectrum[i] = frame[i] * frame[i] + frame[frame_size - i] * frame[frame_size - i];
+		}
+	}
+	const double loops = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+	const Real loops_check = spectrum[frame_size / 4];
+
+	start = Clock::now();
+	for (int n = 0; n < iterations; n++) {
+		WindowFrame(begin, half, half, end, window.data(), frame.data());
+		HalfcomplexPowerSpectrum(frame.data(), frame_size, spectrum.data());
+	}
+	const double kernels = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+
+	ASSERT_EQ(loops_check, spectrum[frame_size / 4]);
+	printf("window + power spectrum of a %d sample frame: loops %.0f ns, kernels %.0f ns\n", (int) frame_size, loops, kernels);
+}
+
+}; // namespace chromaprint
@@ -1,6 +1,7 @@
 // Copyright (C) 2010-2016  Lukas Lalinsky
 // Distributed under the MIT license, see the LICENSE file for details.
 
+#include "fft_kernels.h"
 #include "fft_lib_avfft.h"
 
 namespace chromaprint {
@@ -24,24 +25,17 @@ FFTLib::~FFTLib() {
 }
 
 void FFTLib::Load(const int16_t *b1, const int16_t *e1, const int16_t *b2, const int16_t *e2) {
-	auto window = m_window;
-	auto output = m_input;
-	ApplyWindow(b1, e1, window, output);
-	ApplyWindow(b2, e2, window, output);
+	WindowFrame(b1, e1, b2, e2, m_window, m_input);
 }
 
 void FFTLib::Compute(FFTFrame &frame) {
 	av_rdft_calc(m_rdft_ctx, m_input);
 	auto input = m_input;
-	auto output = frame.begin();
+	auto output = frame.data();
+	// The real parts of the DC and Nyquist bins are packed into the first pair
 	output[0] = input[0] * input[0];
 	output[m_frame_size / 2] = input[1] * input[1];
-	output += 1;
-	input += 2;
-	for (size_t i = 1; i < m_frame_size / 2; i++) {
-		*output++ = input[0] * input[0] + input[1] * input[1];
-		input += 2;
-	}
+	ComplexPowerSpectrum(input + 2, m_frame_size / 2 - 1, output + 1);
 }
 
 }; // namespace chromaprint
@@ -1,46 +1,97 @@
 // Copyright (C) 2010-2016  Lukas Lalinsky
 // Distributed under the MIT license, see the LICENSE file for details.
 
+#include <map>
+#include <mutex>
+#include <tuple>
+#include "fft_kernels.h"
 #include "fft_lib_fftw3.h"
+#include "fft.h"
 
 namespace chromaprint {
 
+// The FFTW planner isn't thread safe, only fftw_execute is
+static std::mutex g_planner_mutex;
+static std::string g_imported_wisdom_file;
+
+struct PlanKey {
+	size_t frame_size;
+	unsigned flags;
+
+	bool operator<(const PlanKey &other) const {
+		return std::tie(frame_size, flags) < std::tie(other.frame_size, other.flags);
+	}
+};
+
+// Plans live until the process exits. They hold no buffers of their own, every
+// FFTLib runs them on its own input and output through the new-array execute.
+static std::map<PlanKey, fftw_plan> g_plans;
+
+static unsigned PlannerFlags() {
+	switch (GetFFTPlanning()) {
+	case FFT_PLAN_MEASURE:
+		return FFTW_MEASURE;
+	case FFT_PLAN_PATIENT:
+		return FFTW_PATIENT;
+	default:
+		return FFTW_ESTIMATE;
+	}
+}
+
+// Must be called with g_planner_mutex held. The new-array execute needs buffers
+// aligned like the ones the plan was made with, fftw_malloc aligns all of them alike.
+static fftw_plan GetPlan(size_t frame_size) {
+	const PlanKey key = { frame_size, PlannerFlags() };
+	auto it = g_plans.find(key);
+	if (it != g_plans.end()) {
+		return it->second;
+	}
+
+	const std::string wisdom_file = GetFFTWisdomFile();
+	if (!wisdom_file.empty() && wisdom_file != g_imported_wisdom_file) {
+		// A missing file just means nothing has been measured yet
+		fftw_import_wisdom_from_filename(wisdom_file.c_str());
+		g_imported_wisdom_file = wisdom_file;
+	}
+
+	// Measuring overwrites the buffers, so the plan is made on scratch ones
+	FFTW_SCALAR *input = (FFTW_SCALAR *) fftw_malloc(sizeof(FFTW_SCALAR) * frame_size);
+	FFTW_SCALAR *output = (FFTW_SCALAR *) fftw_malloc(sizeof(FFTW_SCALAR) * frame_size);
+	fftw_plan plan = fftw_plan_r2r_1d(frame_size, input, output, FFTW_R2HC, key.flags);
+	fftw_free(output);
+	fftw_free(input);
+
+	if (key.flags != FFTW_ESTIMATE && !wisdom_file.empty()) {
+		// Measuring took far longer than rewriting the file
+		fftw_export_wisdom_to_filename(wisdom_file.c_str());
+	}
+	g_plans[key] = plan;
+	return plan;
+}
+
 FFTLib::FFTLib(size_t frame_size) : m_frame_size(frame_size) {
 	m_window = (FFTW_SCALAR *) fftw_malloc(sizeof(FFTW_SCALAR) * frame_size);
 	m_input = (FFTW_SCALAR *) fftw_malloc(sizeof(FFTW_SCALAR) * frame_size);
 	m_output = (FFTW_SCALAR *) fftw_malloc(sizeof(FFTW_SCALAR) * frame_size);
 	PrepareHammingWindow(m_window, m_window + frame_size, 1.0 / INT16_MAX);
-	m_plan = fftw_plan_r2r_1d(frame_size, m_input, m_output, FFTW_R2HC, FFTW_ESTIMATE);
+
+	std::lock_guard<std::mutex> lock(g_planner_mutex);
+	m_plan = GetPlan(frame_size);
 }
 
 FFTLib::~FFTLib() {
-	fftw_destroy_plan(m_plan);
 	fftw_free(m_output);
 	fftw_free(m_input);
 	fftw_free(m_window);
 }
 
 void FFTLib::Load(const int16_t *b1, const int16_t *e1, const int16_t *b2, const int16_t *e2) {
-	auto window = m_window;
-	auto output = m_input;
-	ApplyWindow(b1, e1, window, output);
-	ApplyWindow(b2, e2, window, output);
+	WindowFrame(b1, e1, b2, e2, m_window, m_input);
 }
 
 void FFTLib::Compute(FFTFrame &frame) {
-	fftw_execute(m_plan);
-	auto output = frame.data();
-	auto in_ptr = m_output;
-	auto rev_in_ptr = m_output + m_frame_size - 1;
-	output[0] = in_ptr[0] * in_ptr[0];
-	output[m_frame_size / 2] = in_ptr[m_frame_size / 2] * in_ptr[m_frame_size / 2];
-	in_ptr += 1;
-	output += 1;
-	for (size_t i = 1; i < m_frame_size / 2; i++) {
-		*output++ = in_ptr[0] * in_ptr[0] + rev_in_ptr[0] * rev_in_ptr[0];
-		in_ptr++;
-		rev_in_ptr--;
-	}
+	fftw_execute_r2r(m_plan, m_input, m_output);
+	HalfcomplexPowerSpectrum(m_output, m_frame_size, frame.data());
 }
 
 }; // namespace chromaprint
@@ -14,6 +14,9 @@
 #define fftw_plan fftwf_plan
 #define fftw_plan_r2r_1d fftwf_plan_r2r_1d
 #define fftw_execute fftwf_execute
+#define fftw_execute_r2r fftwf_execute_r2r
+#define fftw_import_wisdom_from_filename fftwf_import_wisdom_from_filename
+#define fftw_export_wisdom_to_filename fftwf_export_wisdom_to_filename
 #define fftw_destroy_plan fftwf_destroy_plan
 #define fftw_malloc fftwf_malloc
 #define fftw_free fftwf_free
@@ -38,6 +41,7 @@ private:
 	FFTW_SCALAR *m_window;
 	FFTW_SCALAR *m_input;
 	FFTW_SCALAR *m_output;
+	// Shared with every FFTLib of the same size, only ever run on this object's buffers
 	fftw_plan m_plan;
 };
 
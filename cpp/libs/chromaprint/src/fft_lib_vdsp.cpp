@@ -2,6 +2,7 @@
 // Distributed under the MIT license, see the LICENSE file for details.
 
 #include <cassert>
+#include "fft_kernels.h"
 #include "fft_lib_vdsp.h"
 
 namespace chromaprint {
@@ -27,22 +28,16 @@ FFTLib::~FFTLib() {
 }
 
 void FFTLib::Load(const int16_t *b1, const int16_t *e1, const int16_t *b2, const int16_t *e2) {
-	auto window = m_window;
-	auto output = m_input;
-	ApplyWindow(b1, e1, window, output);
-	ApplyWindow(b2, e2, window, output);
+	WindowFrame(b1, e1, b2, e2, m_window, m_input);
 }
 
 void FFTLib::Compute(FFTFrame &frame) {
-	vDSP_ctoz((DSPComplex *) m_input, 2, &m_a, 1, m_frame_size / 2); 
+	vDSP_ctoz((DSPComplex *) m_input, 2, &m_a, 1, m_frame_size / 2);
 	vDSP_fft_zrip(m_setup, &m_a, 1, m_log2n, FFT_FORWARD);
 	auto output = frame.data();
 	output[0] = m_a.realp[0] * m_a.realp[0];
 	output[m_frame_size / 2] = m_a.imagp[0] * m_a.imagp[0];
-	output += 1;
-	for (size_t i = 1; i < m_frame_size / 2; ++i, ++output) {
-		*output = m_a.realp[i] * m_a.realp[i] + m_a.imagp[i] * m_a.imagp[i];
-	}
+	SplitComplexPowerSpectrum(m_a.realp + 1, m_a.imagp + 1, m_frame_size / 2 - 1, output + 1);
 }
 
 }; // namespace chromaprint
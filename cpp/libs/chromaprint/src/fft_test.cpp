@@ -134,4 +134,42 @@ TEST(FFTTest, DC) {
 	}
 }
 
+TEST(FFTTest, SameSizeFFTsKeepTheirOwnBuffers) {
+	const size_t frame_size = 64;
+	const size_t overlap = 32;
+
+	std::vector<int16_t> input1(1000), input2(1000);
+	for (size_t i = 0; i < input1.size(); i++) {
+		input1[i] = INT16_MAX * sin(i * 0.3);
+		input2[i] = INT16_MAX * sin(i * 0.05);
+	}
+
+	Collector expected1, expected2;
+	{
+		FFT fft1(frame_size, overlap, &expected1);
+		fft1.Consume(input1.data(), input1.size());
+		FFT fft2(frame_size, overlap, &expected2);
+		fft2.Consume(input2.data(), input2.size());
+	}
+
+	// Both share one plan, interleaving them must not mix up their frames
+	Collector collector1, collector2;
+	FFT fft1(frame_size, overlap, &collector1);
+	FFT fft2(frame_size, overlap, &collector2);
+	const size_t chunk_size = 100;
+	for (size_t i = 0; i < input1.size(); i += chunk_size) {
+		fft1.Consume(input1.data() + i, chunk_size);
+		fft2.Consume(input2.data() + i, chunk_size);
+	}
+
+	ASSERT_EQ(expected1.frames.size(), collector1.frames.size());
+	ASSERT_EQ(expected2.frames.size(), collector2.frames.size());
+	for (size_t j = 0; j < collector1.frames.size(); j++) {
+		for (size_t i = 0; i < frame_size / 2 + 1; i++) {
+			ASSERT_EQ(expected1.frames[j][i], collector1.frames[j][i]) << "frame " << j << " bin " << i;
+			ASSERT_EQ(expected2.frames[j][i], collector2.frames[j][i]) << "frame " << j << " bin " << i;
+		}
+	}
+}
+
 }; // namespace chromaprint
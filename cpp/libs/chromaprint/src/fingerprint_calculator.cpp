@@ -9,7 +9,8 @@
 namespace chromaprint {
 
 FingerprintCalculator::FingerprintCalculator(const Classifier *classifiers, size_t num_classifiers)
-	: m_classifiers(classifiers), m_num_classifiers(num_classifiers), m_image(256)
+	: m_classifiers(classifiers), m_num_classifiers(num_classifiers),
+	  m_calculate(FindSubfingerprintFunc(classifiers, num_classifiers)), m_image(256)
 {
 	m_max_filter_width = 0;
 	for (size_t i = 0; i < num_classifiers; i++) {
@@ -21,6 +22,9 @@ FingerprintCalculator::FingerprintCalculator(const Classifier *classifiers, size
 
 uint32_t FingerprintCalculator::CalculateSubfingerprint(size_t offset)
 {
+	if (m_calculate && offset > 0) {
+		return m_calculate(m_image, offset);
+	}
 	uint32_t bits = 0;
 	for (size_t i = 0; i < m_num_classifiers; i++) {
 		bits = (bits << 2) | GrayCode(m_classifiers[i].Classify(m_image, offset));
@@ -33,8 +37,8 @@ void FingerprintCalculator::Reset() {
 	m_fingerprint.clear();
 }
 
-void FingerprintCalculator::Consume(std::vector<double> &features) {
-	m_image.AddRow(features);
+void FingerprintCalculator::Consume(FeatureSpan features) {
+	m_image.AddRow(features.begin(), features.end());
 	if (m_image.num_rows() >= m_max_filter_width) {
 		m_fingerprint.push_back(CalculateSubfingerprint(m_image.num_rows() - m_max_filter_width));
 	}
@@ -8,6 +8,7 @@
 #include <vector>
 #include "feature_vector_consumer.h"
 #include "utils/rolling_integral_image.h"
+#include "classifier_bank.h"
 
 namespace chromaprint {
 
@@ -19,7 +20,7 @@ class FingerprintCalculator : public FeatureVectorConsumer {
 public:
 	FingerprintCalculator(const Classifier *classifiers, size_t num_classifiers);
 
-	virtual void Consume(std::vector<double> &features) override;
+	virtual void Consume(FeatureSpan features) override;
 
 	//! Get the fingerprint generate from data up to this point.
 	const std::vector<uint32_t> &GetFingerprint() const;
@@ -36,6 +37,7 @@ private:
 	const Classifier *m_classifiers;
 	size_t m_num_classifiers;
 	size_t m_max_filter_width;
+	SubfingerprintFunc m_calculate;
 	RollingIntegralImage m_image;
 	std::vector<uint32_t> m_fingerprint;
 };
@@ -2,6 +2,7 @@
 // Distributed under the MIT license, see the LICENSE file for details.
 
 #include <string.h>
+#include <limits>
 #include "fingerprinter.h"
 #include "chroma.h"
 #include "chroma_normalizer.h"
@@ -82,6 +83,59 @@ bool Fingerprinter::Start(int sample_rate, int num_channels)
 	return true;
 }
 
+void Fingerprinter::SetFeatureConsumer(FeatureVectorConsumer *consumer)
+{
+	m_chroma_normalizer->set_consumer(consumer ? consumer : m_fingerprint_calculator);
+}
+
+static int64_t GreatestCommonDivisor(int64_t a, int64_t b)
+{
+	while (b) {
+		int64_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+bool Fingerprinter::GetRestartPoints(int sample_rate, int *input_step, int *row_step, int *skip_rows, int *lookahead) const
+{
+	// The silence remover drops audio depending on everything before it
+	if (m_silence_remover || sample_rate <= 0) {
+		return false;
+	}
+	int warmup, block;
+	if (!m_audio_processor->GetRestartLimits(sample_rate, &warmup, &block, lookahead)) {
+		return false;
+	}
+	// The resampler maps output sample n to input position n * sample_rate / target exactly,
+	// so a cut has to land on an input sample, an output block and an FFT frame at once
+	int64_t target = m_audio_processor->target_sample_rate();
+	int64_t hop = m_config->frame_size() - m_config->frame_overlap();
+	if (hop <= 0) {
+		return false;
+	}
+	int64_t output_step = target / GreatestCommonDivisor(target, sample_rate);
+	output_step = output_step / GreatestCommonDivisor(output_step, block) * block;
+	output_step = output_step / GreatestCommonDivisor(output_step, hop) * hop;
+	int64_t step = output_step * sample_rate / target;
+	if (step > std::numeric_limits<int>::max()) {
+		return false;
+	}
+	*input_step = (int)step;
+	*row_step = (int)(output_step / hop);
+	// A vector is wrong if any of its frames saw the mirrored warm-up samples
+	*skip_rows = (int)((warmup + hop - 1) / hop);
+	return true;
+}
+
+int Fingerprinter::GetTargetSampleRate(const FingerprinterConfiguration *config)
+{
+	// sample_rate() reads a default that every translation unit has its own copy
+	// of, so it is read here like the constructor reads it
+	return config->sample_rate();
+}
+
 void Fingerprinter::Consume(const int16_t *samples, int length)
 {
 	assert(length >= 0);
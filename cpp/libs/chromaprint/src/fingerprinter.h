@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <vector>
 #include "audio_consumer.h"
+#include "feature_vector_consumer.h"
 
 namespace chromaprint {
 
@@ -49,6 +50,28 @@ public:
 
 	bool SetOption(const char *name, int value);
 
+	/**
+	 * Send the normalized chroma features to consumer instead of the
+	 * fingerprint calculator, pass 0 to calculate the fingerprint again.
+	 */
+	void SetFeatureConsumer(FeatureVectorConsumer *consumer);
+
+	/**
+	 * Find where audio at sample_rate can be cut and fingerprinted by separate
+	 * fingerprinters. Starting a fresh stream at input frame k * input_step gives
+	 * the same feature vectors as the whole stream from vector k * row_step on,
+	 * except for the first skip_rows vectors, as long as the whole stream goes on
+	 * for lookahead frames after the restart point. A vector is only complete once
+	 * lookahead input frames past its audio have been consumed. Returns false
+	 * if the stream can only be processed in one piece.
+	 */
+	bool GetRestartPoints(int sample_rate, int *input_step, int *row_step, int *skip_rows, int *lookahead) const;
+
+	//! Rate a fingerprinter made with config resamples the audio to before the
+	//! FFT, without making one. Mono audio at this rate goes straight through
+	//! without being copied.
+	static int GetTargetSampleRate(const FingerprinterConfiguration *config);
+
 	const FingerprinterConfiguration *config() { return m_config; }
 
 private:
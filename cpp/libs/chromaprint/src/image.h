@@ -5,11 +5,12 @@
 #define CHROMAPRINT_IMAGE_H_
 
 #include <vector>
+#include "precision.h"
 #include <algorithm>
 #include <cassert>
 
 #ifdef NDEBUG
-#define CHROMAPRINT_IMAGE_ROW_TYPE double *
+#define CHROMAPRINT_IMAGE_ROW_TYPE Real *
 #define CHROMAPRINT_IMAGE_ROW_TYPE_CAST(x, c) x
 #else
 #define CHROMAPRINT_IMAGE_ROW_TYPE ImageRow
@@ -21,25 +22,25 @@ namespace chromaprint {
 class ImageRow
 {
 public:
-	explicit ImageRow(double *data, int columns) : m_data(data), m_columns(columns)
+	explicit ImageRow(Real *data, int columns) : m_data(data), m_columns(columns)
 	{
 	}
 
 	int NumColumns() const { return m_columns; }
 
-	double &Column(int i)
+	Real &Column(int i)
 	{
 		assert(0 <= i && i < NumColumns());
 		return m_data[i];
 	}
 
-	double &operator[](int i)
+	Real &operator[](int i)
 	{
 		return Column(i);
 	}
 
 private:
-	double *m_data;
+	Real *m_data;
 	int m_columns;
 };
 
@@ -62,10 +63,15 @@ public:
 	int NumColumns() const { return m_columns; }
 	int NumRows() const { return m_data.size() / m_columns; }
 
-	void AddRow(const std::vector<double> &row)
+	//! Appends NumColumns() values, the storage grows geometrically like any vector
+	void AddRow(const Real *row)
 	{
-		m_data.resize(m_data.size() + m_columns);
-		std::copy(row.begin(), row.end(), m_data.end() - m_columns);
+		m_data.insert(m_data.end(), row, row + m_columns);
+	}
+
+	void AddRow(const std::vector<Real> &row)
+	{
+		AddRow(row.data());
 	}
 
 	CHROMAPRINT_IMAGE_ROW_TYPE Row(int i)
@@ -81,7 +87,7 @@ public:
 
 private:
 	int m_columns;
-	std::vector<double> m_data;
+	std::vector<Real> m_data;
 };
 
 }; // namespace chromaprint
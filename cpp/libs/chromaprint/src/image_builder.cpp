@@ -17,10 +17,10 @@ ImageBuilder::~ImageBuilder()
 {
 }
 
-void ImageBuilder::Consume(std::vector<double> &features)
+void ImageBuilder::Consume(FeatureSpan features)
 {
 	assert(features.size() == (size_t)m_image->NumColumns());
-	m_image->AddRow(features);
+	m_image->AddRow(features.data());
 }
 
 }; // namespace chromaprint
@@ -0,0 +1,20 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#ifndef CHROMAPRINT_PRECISION_H_
+#define CHROMAPRINT_PRECISION_H_
+
+namespace chromaprint {
+
+//! Scalar type of spectra, chroma features and images. The output is quantized to
+//! two bits per classifier, so float halves the memory traffic without moving the
+//! fingerprint: tests/test_precision.cpp allows at most 0.1% of bits to differ from
+//! the double build, and the float builds with kissfft and fftw3f currently flip none.
+#ifdef CHROMAPRINT_SINGLE_PRECISION
+typedef float Real;
+#else
+typedef double Real;
+#endif
+
+}; // namespace chromaprint
+
+#endif
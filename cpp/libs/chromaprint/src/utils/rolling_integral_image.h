@@ -8,7 +8,9 @@
 #include <cassert>
 #include <algorithm>
 #include <numeric>
+#include <vector>
 #include "debug.h"
+#include "precision.h"
 
 namespace chromaprint {
 
@@ -82,8 +84,14 @@ public:
 
 		assert(m_num_columns == size);
 
+		// Sums stay in double whatever the features are, they run over the whole stream
+		// and the classifiers take small differences of them
 		auto current_row_begin = GetRow(m_num_rows);
-		std::partial_sum(begin, end, current_row_begin);
+		double sum = 0.0;
+		for (auto it = current_row_begin; begin != end; ++begin, ++it) {
+			sum += *begin;
+			*it = sum;
+		}
 
 		if (m_num_rows > 0) {
 			auto last_row_begin = GetRow(m_num_rows - 1);
@@ -95,10 +103,24 @@ public:
 		m_num_rows++;
 	}
 
-	void AddRow(const std::vector<double> &row) {
+	void AddRow(const std::vector<Real> &row) {
 		AddRow(row.begin(), row.end());
 	}
 
+	//! Fills rows with pointers to count consecutive rows starting at first, with a
+	//! single modulo for the whole range. The rows must still be in the window.
+	void GetRows(size_t first, size_t count, const double **rows) const {
+		assert(first + count <= m_num_rows);
+		assert(count <= m_max_rows);
+		size_t i = first % m_max_rows;
+		for (size_t j = 0; j < count; j++) {
+			rows[j] = m_data.data() + i * m_num_columns;
+			if (++i == m_max_rows) {
+				i = 0;
+			}
+		}
+	}
+
 private:
 
 	std::vector<double>::iterator GetRow(size_t i) {
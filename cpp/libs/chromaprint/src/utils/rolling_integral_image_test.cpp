@@ -12,7 +12,7 @@ TEST(RollingIntegralImageTest, All) {
 	RollingIntegralImage image(4);
 
 	{
-		std::vector<double> data { 1, 2, 3 };
+		std::vector<Real> data { 1, 2, 3 };
 		image.AddRow(data);
 	}
 
@@ -25,7 +25,7 @@ TEST(RollingIntegralImageTest, All) {
 	ASSERT_DOUBLE_EQ(1 + 2 + 3, image.Area(0, 0, 1, 3));
 
 	{
-		std::vector<double> data { 4, 5, 6 };
+		std::vector<Real> data { 4, 5, 6 };
 		image.AddRow(data);
 	}
 
@@ -38,7 +38,7 @@ TEST(RollingIntegralImageTest, All) {
 	ASSERT_DOUBLE_EQ(1 + 2 + 3 + 4 + 5 + 6, image.Area(0, 0, 2, 3));
 
 	{
-		std::vector<double> data { 7, 8, 9 };
+		std::vector<Real> data { 7, 8, 9 };
 		image.AddRow(data);
 	}
 
@@ -46,7 +46,7 @@ TEST(RollingIntegralImageTest, All) {
 	ASSERT_EQ(3, image.num_rows());
 
 	{
-		std::vector<double> data { 10, 11, 12 };
+		std::vector<Real> data { 10, 11, 12 };
 		image.AddRow(data);
 	}
 
@@ -56,7 +56,7 @@ TEST(RollingIntegralImageTest, All) {
 	ASSERT_DOUBLE_EQ((1 + 2 + 3) + (4 + 5 + 6) + (7 + 8 + 9) + (10 + 11 + 12), image.Area(0, 0, 4, 3));
 
 	{
-		std::vector<double> data { 13, 14, 15 };
+		std::vector<Real> data { 13, 14, 15 };
 		image.AddRow(data);
 	}
 
@@ -72,7 +72,7 @@ TEST(RollingIntegralImageTest, All) {
 	ASSERT_DOUBLE_EQ((4 + 5 + 6) + (7 + 8 + 9) + (10 + 11 + 12) + (13 + 14 + 15), image.Area(1, 0, 5, 3));
 
 	{
-		std::vector<double> data { 16, 17, 18 };
+		std::vector<Real> data { 16, 17, 18 };
 		image.AddRow(data);
 	}
 
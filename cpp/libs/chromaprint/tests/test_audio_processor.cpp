@@ -43,6 +43,32 @@ TEST(AudioProcessor, PassThrough)
 	}
 }
 
+TEST(AudioProcessor, PassThroughForwardsInput)
+{
+	std::vector<short> data = LoadAudioFile("data/test_mono_44100.raw");
+
+	class CountingBuffer : public AudioBuffer
+	{
+	public:
+		void Consume(const int16_t *input, int length) override
+		{
+			calls++;
+			AudioBuffer::Consume(input, length);
+		}
+		int calls = 0;
+	};
+
+	CountingBuffer buffer;
+	AudioProcessor processor(44100, &buffer);
+	processor.Reset(44100, 1);
+	processor.Consume(data.data(), data.size());
+	processor.Flush();
+
+	ASSERT_EQ(1, buffer.calls);
+	ASSERT_EQ(data.size(), buffer.data().size());
+	ASSERT_TRUE(std::equal(data.begin(), data.end(), buffer.data().begin()));
+}
+
 TEST(AudioProcessor, StereoToMono)
 {
 	std::vector<short> data1 = LoadAudioFile("data/test_stereo_44100.raw");
@@ -110,3 +136,50 @@ TEST(AudioProcessor, StereoToMonoAndResample)
 		ASSERT_EQ(data2[i], buffer.data()[i]) << "Signals differ at index " << i;
 	}
 }
+
+static void CheckRestart(const std::vector<short> &data, int sample_rate, int target_sample_rate, size_t input_offset, size_t output_offset)
+{
+	AudioBuffer whole;
+	AudioProcessor processor1(target_sample_rate, &whole);
+	processor1.Reset(sample_rate, 1);
+	processor1.Consume(data.data(), data.size());
+	processor1.Flush();
+
+	AudioBuffer part;
+	AudioProcessor processor2(target_sample_rate, &part);
+	processor2.Reset(sample_rate, 1);
+	processor2.Consume(data.data() + input_offset, data.size() - input_offset);
+	processor2.Flush();
+
+	int warmup, block, lookahead;
+	ASSERT_TRUE(processor2.GetRestartLimits(sample_rate, &warmup, &block, &lookahead));
+	ASSERT_EQ(0, output_offset % block);
+	ASSERT_EQ(whole.data().size() - output_offset, part.data().size());
+	for (size_t i = warmup; i < part.data().size(); i++) {
+		ASSERT_EQ(whole.data()[output_offset + i], part.data()[i]) << "Signals differ at index " << i;
+	}
+}
+
+TEST(AudioProcessor, RestartPassThrough)
+{
+	std::vector<short> data = LoadAudioFile("data/test_mono_44100.raw");
+	CheckRestart(data, 44100, 44100, 12345, 12345);
+}
+
+TEST(AudioProcessor, RestartResampleDown)
+{
+	std::vector<short> data = LoadAudioFile("data/test_mono_44100.raw");
+	CheckRestart(data, 44100, 11025, 40000, 10000);
+}
+
+TEST(AudioProcessor, RestartResampleUp)
+{
+	// Every block is full size when resampling up, the restart needs a whole buffer after it
+	std::vector<short> part = LoadAudioFile("data/test_mono_11025.raw");
+	std::vector<short> data;
+	for (int i = 0; i < 4; i++) {
+		data.insert(data.end(), part.begin(), part.end());
+	}
+	CheckRestart(data, 11025, 44100, 8192, 32768);
+	CheckRestart(data, 11025, 44100, 16384, 65536);
+}
@@ -1,5 +1,7 @@
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <gtest/gtest.h>
 #include "fft_frame.h"
 #include "chroma.h"
@@ -9,12 +11,12 @@ using namespace chromaprint;
 class FeatureVectorBuffer : public FeatureVectorConsumer
 {
 public:
-	void Consume(std::vector<double> &features)
+	void Consume(FeatureSpan features)
 	{
-		m_features = features;
+		m_features.assign(features.begin(), features.end());
 	}
 
-	std::vector<double> m_features;
+	std::vector<Real> m_features;
 };
 
 TEST(Chroma, NormalA) {
@@ -122,3 +124,121 @@ TEST(Chroma, InterpolatedGSharp) {
 	}
 }
 
+// The loop Chroma::Consume used to run, scattering every bin into its band
+class ScatterChroma
+{
+public:
+	ScatterChroma(int min_freq, int max_freq, int frame_size, int sample_rate, bool interpolate)
+		: m_interpolate(interpolate), m_notes(frame_size), m_notes_frac(frame_size)
+	{
+		m_min_index = std::max(1, FreqToIndex(min_freq, frame_size, sample_rate));
+		m_max_index = std::min(frame_size / 2, FreqToIndex(max_freq, frame_size, sample_rate));
+		for (int i = m_min_index; i < m_max_index; i++) {
+			double octave = log(IndexToFreq(i, frame_size, sample_rate) / (440.0 / 16.0)) / log(2.0);
+			double note = kNumBands * (octave - floor(octave));
+			m_notes[i] = (char)note;
+			m_notes_frac[i] = note - m_notes[i];
+		}
+	}
+
+	std::vector<Real> Compute(const FFTFrame &frame) const
+	{
+		std::vector<Real> features(kNumBands, 0.0);
+		for (int i = m_min_index; i < m_max_index; i++) {
+			int note = m_notes[i];
+			Real energy = frame[i];
+			if (m_interpolate) {
+				int note2 = note;
+				double a = 1.0;
+				if (m_notes_frac[i] < 0.5) {
+					note2 = (note + kNumBands - 1) % kNumBands;
+					a = 0.5 + m_notes_frac[i];
+				}
+				if (m_notes_frac[i] > 0.5) {
+					note2 = (note + 1) % kNumBands;
+					a = 1.5 - m_notes_frac[i];
+				}
+				features[note] += energy * a;
+				features[note2] += energy * (1.0 - a);
+			}
+			else {
+				features[note] += energy;
+			}
+		}
+		return features;
+	}
+
+private:
+	static const int kNumBands = 36;
+	bool m_interpolate;
+	std::vector<char> m_notes;
+	std::vector<double> m_notes_frac;
+	int m_min_index;
+	int m_max_index;
+};
+
+static FFTFrame NoiseFrame(int frame_size, uint32_t seed)
+{
+	FFTFrame frame(frame_size / 2 + 1);
+	for (size_t i = 0; i < frame.size(); i++) {
+		seed = seed * 1103515245 + 12345;
+		frame[i] = (seed >> 8) * (1.0 / (1 << 24));
+	}
+	return frame;
+}
+
+TEST(Chroma, MatchesScatter) {
+	const int configs[][2] = { { 4096, 11025 }, { 32768, 48000 } };
+	for (const auto &config : configs) {
+		for (int interpolate = 0; interpolate < 2; interpolate++) {
+			FeatureVectorBuffer buffer;
+			Chroma chroma(28, 10504, config[0], config[1], &buffer);
+			chroma.set_interpolate(interpolate);
+			ScatterChroma scatter(28, 10504, config[0], config[1], interpolate);
+			for (uint32_t seed = 1; seed <= 3; seed++) {
+				FFTFrame frame = NoiseFrame(config[0], seed);
+				chroma.Consume(frame);
+				std::vector<Real> expected = scatter.Compute(frame);
+				ASSERT_EQ(expected.size(), buffer.m_features.size());
+				for (size_t i = 0; i < expected.size(); i++) {
+					// The same additions in the same order, so not even the last bit may differ
+					ASSERT_EQ(expected[i], buffer.m_features[i]) << "frame size " << config[0] << " interpolate " << interpolate << " band " << i;
+				}
+			}
+		}
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(Chroma, DISABLED_Benchmark) {
+	typedef std::chrono::steady_clock Clock;
+	const int configs[][2] = { { 4096, 11025 }, { 32768, 48000 } };
+	for (const auto &config : configs) {
+		for (int interpolate = 0; interpolate < 2; interpolate++) {
+			const int iterations = 4000000 / config[0];
+			FeatureVectorBuffer buffer;
+			Chroma chroma(28, 10504, config[0], config[1], &buffer);
+			chroma.set_interpolate(interpolate);
+			ScatterChroma scatter(28, 10504, config[0], config[1], interpolate);
+			FFTFrame frame = NoiseFrame(config[0], 1);
+
+			auto start = Clock::now();
+			Real scatter_sum = 0.0;
+			for (int n = 0; n < iterations; n++) {
+				scatter_sum += scatter.Compute(frame)[n % 36];
+			}
+			const double scatter_time = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+			start = Clock::now();
+			Real chroma_sum = 0.0;
+			for (int n = 0; n < iterations; n++) {
+				chroma.Consume(frame);
+				chroma_sum += buffer.m_features[n % 36];
+			}
+			const double chroma_time = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+			EXPECT_EQ(scatter_sum, chroma_sum);
+			printf("frame %d interpolate %d: scatter %.2f us, chroma %.2f us\n", config[0], interpolate, scatter_time, chroma_time);
+		}
+	}
+}
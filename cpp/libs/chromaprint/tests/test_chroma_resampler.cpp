@@ -12,9 +12,9 @@ TEST(ChromaResampler, Test1) {
 	double d1[] = { 0.0, 5.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
 	double d2[] = { 1.0, 6.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
 	double d3[] = { 2.0, 7.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
-	std::vector<double> v1(d1, d1 + 12);
-	std::vector<double> v2(d2, d2 + 12);
-	std::vector<double> v3(d3, d3 + 12);
+	std::vector<Real> v1(d1, d1 + 12);
+	std::vector<Real> v2(d2, d2 + 12);
+	std::vector<Real> v3(d3, d3 + 12);
 	resampler.Consume(v1);
 	resampler.Consume(v2);
 	resampler.Consume(v3);
@@ -31,10 +31,10 @@ TEST(ChromaResampler, Test2) {
 	double d2[] = { 1.0, 6.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
 	double d3[] = { 2.0, 7.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
 	double d4[] = { 3.0, 8.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
-	std::vector<double> v1(d1, d1 + 12);
-	std::vector<double> v2(d2, d2 + 12);
-	std::vector<double> v3(d3, d3 + 12);
-	std::vector<double> v4(d4, d4 + 12);
+	std::vector<Real> v1(d1, d1 + 12);
+	std::vector<Real> v2(d2, d2 + 12);
+	std::vector<Real> v3(d3, d3 + 12);
+	std::vector<Real> v4(d4, d4 + 12);
 	resampler.Consume(v1);
 	resampler.Consume(v2);
 	resampler.Consume(v3);
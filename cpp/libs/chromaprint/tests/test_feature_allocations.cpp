@@ -0,0 +1,94 @@
+// Distributed under the MIT license, see the LICENSE file for details.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <gtest/gtest.h>
+#include "fft_frame.h"
+#include "chroma.h"
+#include "chroma_filter.h"
+#include "chroma_normalizer.h"
+#include "fingerprint_calculator.h"
+#include "fingerprinter_configuration.h"
+
+// Counts every allocation the test binary makes, the tests below look at the
+// difference across the frames they feed
+static std::atomic<long> g_num_allocations(0);
+
+void *operator new(size_t size)
+{
+	g_num_allocations++;
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+namespace chromaprint {
+
+TEST(FeatureAllocations, NoneAfterWarmUp) {
+	const int frame_size = 4096;
+	const int sample_rate = 11025;
+	const int num_frames = 200;
+
+	FingerprinterConfigurationTest2 config;
+	FingerprintCalculator calculator(config.classifiers(), config.num_classifiers());
+	ChromaNormalizer normalizer(&calculator);
+	ChromaFilter filter(config.filter_coefficients(), config.num_filter_coefficients(), &normalizer);
+	Chroma chroma(28, 3500, frame_size, sample_rate, &filter);
+
+	std::vector<FFTFrame> frames(16, FFTFrame(frame_size / 2 + 1));
+	uint32_t state = 12345;
+	for (size_t i = 0; i < frames.size(); i++) {
+		for (size_t j = 0; j < frames[i].size(); j++) {
+			state = state * 1103515245 + 12345;
+			frames[i][j] = (state >> 16) / 64.0;
+		}
+	}
+
+	// The integral image and the fingerprint get their storage on the first frames,
+	// ClearFingerprint keeps the capacity for the rest
+	for (int i = 0; i < num_frames; i++) {
+		chroma.Consume(frames[i % frames.size()]);
+	}
+	ASSERT_FALSE(calculator.GetFingerprint().empty());
+	calculator.ClearFingerprint();
+
+	const long before = g_num_allocations;
+	for (int i = 0; i < num_frames; i++) {
+		chroma.Consume(frames[i % frames.size()]);
+	}
+	const long after = g_num_allocations;
+
+	EXPECT_EQ(0, after - before);
+	EXPECT_EQ(size_t(num_frames), calculator.GetFingerprint().size());
+}
+
+}; // namespace chromaprint
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+#include "test_utils.h"
+#include "chromaprint.h"
+#include "fingerprinter.h"
+#include "fingerprinter_configuration.h"
+#include "precision.h"
+#include "utils.h"
+
+using namespace chromaprint;
+
+// 30 seconds of the stereo test clip mixed with a triangle wave that jumps to a
+// new pitch every quarter second, long enough to give TEST5 a real fingerprint
+static std::vector<short> MakeMelody()
+{
+	std::vector<short> clip = LoadAudioFile("data/test_stereo_44100.raw");
+	std::vector<short> data;
+	uint32_t seed = 1;
+	int period = 100, phase = 0;
+	for (size_t i = 0; i < 44100 * 30; i++) {
+		if (i % 11025 == 0) {
+			seed = seed * 1103515245 + 12345;
+			period = 50 + (seed >> 16) % 200;
+		}
+		phase = (phase + 1) % period;
+		int triangle = (phase < period / 2 ? phase : period - phase) * 16000 / period - 4000;
+		size_t j = (2 * i) % clip.size();
+		data.push_back((short)(clip[j] / 2 + triangle));
+		data.push_back((short)(clip[j + 1] / 2 + triangle));
+	}
+	return data;
+}
+
+// Fingerprint of MakeMelody() from the double precision build with kissfft, which
+// transforms in float (kiss_fft_scalar) whatever the build precision. The double
+// build with fftw3, which transforms in double, gives the same bits.
+static uint32_t kExpectedFingerprint[] = {
+	0xc369f5dd, 0xc169f5dd, 0xc369f55d, 0x4369f559, 0x4369f558, 0x4369f558,
+	0x4369f558, 0x4369f558, 0x436ff518, 0x436ff518, 0x436ff518, 0x436ff518,
+	0x432ff518, 0x422fb518, 0x022f9718, 0x022f9718, 0x022f9718, 0x022f9718,
+	0x022f9718, 0x022f9718, 0x022e9718, 0x022e9718, 0x026e9718, 0x426e9658,
+	0x426e9658, 0x426e96d8, 0x426e96fc, 0x436eb6fc, 0x43e7b6fc, 0x43e7f7bc,
+	0xc7e7f7b4, 0xc5e7f7b4, 0xc5e7f7b5, 0xc5e7f7b1, 0xc5e7f7b1, 0xc4e5f7b3,
+	0x84e177b3, 0x84e175b3, 0x84e17db3, 0x84e17df3, 0x84e17df3, 0x84e13df3,
+	0x84e13df3, 0x84e13df3, 0x84e13d73, 0x84e13973, 0x84e53933, 0x8ce53933,
+	0x8ce53933, 0x8ce53933, 0x8ced3933, 0x8ced7933, 0x8ced7d33, 0x8c6d7d31,
+	0x8c697d31, 0x8d697d11, 0x89697d11, 0x896b7d11, 0x896bdd11, 0x896bdd11,
+	0x896bdd11, 0x896bdd11, 0x896bd511, 0xc96bd511, 0xc96bd511, 0xc96bd511,
+	0xc96bd511, 0xc96bd511, 0xc96bd513, 0xc96bd513, 0xcb6bd513, 0xcb6bd553,
+	0xcb6bd553, 0x4f6bd553, 0x4f6bd552, 0x4f6b5552, 0x4f7b5552, 0x477b5552,
+	0x477b5552, 0x47795552, 0x477955d2, 0x037955d6, 0x035955d6, 0x035955d6,
+	0x011955d6, 0x011955d6, 0x011955d6, 0x011955d6, 0x011955d6, 0x011955d6,
+	0x010955d2, 0x010b55d2, 0x004b55d2, 0x004b55d2, 0x004f55d2, 0x004f55d2,
+	0x005fd1d2, 0x005ff1d2, 0x015ff5b2, 0x015ff5b2, 0x015ff7b3, 0x015ff7b3,
+	0x0177b7b3, 0x0177b7b3, 0x0175b7b3, 0x05f5b7b3, 0x05e5b6b3, 0x07e5b6b3,
+	0x07e5b6b3, 0x07e5b6b3, 0x47e5aeb3, 0x4765aeb3, 0x4765aeb3, 0x4665aeb3,
+	0xc665aea3, 0xd66daee3, 0xd66daee3, 0xd66daee3, 0xd66daee1, 0x966caee1,
+	0xb66cbe61, 0xb66cbe61, 0xb66cbe61, 0xb668fe21, 0xb668fe21, 0xb668ff21,
+	0xb668ff21, 0xb668ff23, 0xa768fb23, 0xa769fb33, 0xa7695b33, 0xaf695933,
+	0xaf697933, 0xaf697933, 0xaf693933, 0xad693933, 0xad693933, 0xad693913,
+	0xe9693813, 0xf9693812, 0xf9e93812, 0xf9e93812, 0xf9e93812, 0x79eb3812,
+	0x79eb3812, 0x58eb3812, 0x58eb3802, 0x58eb3802, 0x18eb3802, 0x08eb3802,
+	0x08eb3803, 0x08eb3803, 0x08eb3803, 0x08eb3803, 0x08eb3803, 0x08fb1843,
+	0x08fb1841,
+};
+
+// Builds that made the reference have to reproduce it exactly
+#if !defined(CHROMAPRINT_SINGLE_PRECISION) && (defined(USE_KISSFFT) || defined(USE_FFTW3))
+static const bool kReferenceBuild = true;
+#else
+static const bool kReferenceBuild = false;
+#endif
+
+// Share of bits any other build may flip against the double build, see precision.h
+static const double kMaxBitErrorRate = 0.001;
+
+TEST(Precision, MatchesDoubleBuild)
+{
+	std::vector<short> data = MakeMelody();
+
+	Fingerprinter fingerprinter(CreateFingerprinterConfiguration(CHROMAPRINT_ALGORITHM_TEST5, 44100));
+	fingerprinter.Start(44100, 2);
+	fingerprinter.Consume(&data[0], data.size());
+	fingerprinter.Finish();
+	std::vector<uint32_t> fingerprint = fingerprinter.GetFingerprint();
+
+	if (kReferenceBuild) {
+		CheckFingerprints(fingerprint, kExpectedFingerprint, NELEMS(kExpectedFingerprint));
+		return;
+	}
+
+	ASSERT_EQ(NELEMS(kExpectedFingerprint), fingerprint.size());
+	size_t errors = 0;
+	for (size_t i = 0; i < fingerprint.size(); i++) {
+		errors += CountSetBits(fingerprint[i] ^ kExpectedFingerprint[i]);
+	}
+	EXPECT_LE(errors, kMaxBitErrorRate * 32 * fingerprint.size()) << errors << " bits differ";
+}
@@ -0,0 +1,81 @@
+#ifndef DEFINED_THREAD_POOL_HPP
+#define DEFINED_THREAD_POOL_HPP
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads pulling tasks off a shared queue
+// Tasks may submit more tasks, wait() returns once the queue is drained and every worker is idle
+class ThreadPool{
+public:
+    explicit ThreadPool(int threads){
+        if(threads < 1)
+            threads = 1;
+        for(int i=0; i<threads; i++)
+            workers.emplace_back([this]{ run(); });
+    }
+
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for(std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        taskReady.notify_one();
+    }
+
+    void wait(){
+        std::unique_lock<std::mutex> lock(mutex);
+        allIdle.wait(lock, [this]{ return tasks.empty() && active == 0; });
+    }
+
+    int size() const { return (int)workers.size(); }
+
+private:
+    void run(){
+        while(true){
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this]{ return stopping || !tasks.empty(); });
+                if(tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                active++;
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active--;
+                if(tasks.empty() && active == 0)
+                    allIdle.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::condition_variable allIdle;
+    int active = 0;
+    bool stopping = false;
+};
+
+#endif
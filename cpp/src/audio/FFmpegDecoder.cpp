@@ -0,0 +1,109 @@
+#include "FFmpegDecoder.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <strings.h>
+
+// Extensions the wav mapper and AudioFile read without FFmpeg
+static bool isPCMFile(const char* path){
+    const char* dot = strrchr(path, '.');
+    if(!dot)
+        return false;
+    for(const char* extension : {".wav", ".wave", ".aif", ".aiff", ".aifc"}){
+        if(!strcasecmp(dot, extension))
+            return true;
+    }
+    return false;
+}
+
+#ifdef INTROMARK_FFMPEG
+#include <audio/ffmpeg_audio_reader.h>
+
+using chromaprint::FFmpegAudioReader;
+
+static void openReader(FFmpegAudioReader& reader, const char* path){
+    if(!reader.Open(path)){
+        std::cerr << "Couldn't decode " << path << ": " << reader.GetError() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+bool isStreamedFile(const char* path){
+    return !isPCMFile(path);
+}
+
+int probeSampleRate(const char* path){
+    FFmpegAudioReader reader;
+    openReader(reader, path);
+    return reader.GetSampleRate();
+}
+
+size_t streamAudioFile(const char* path, int sample_rate, AudioRegion region,
+    const std::function<void(const int16_t*, size_t)>& consume, size_t* first){
+    FFmpegAudioReader reader;
+    reader.SetOutputSampleRate(sample_rate);
+    reader.SetOutputChannels(1);
+    openReader(reader, path);
+
+    // Frames before the region are decoded and dropped, decoding stops at its end
+    size_t start = 0;
+    size_t end = SIZE_MAX;
+    if(!isWholeFile(region)){
+        int durationMs = reader.GetDuration();
+        if(region.start < 0 && durationMs < 0)
+            std::cerr << "No duration in " << path << ", using all of it" << std::endl;
+        else{
+            int frames = durationMs < 0 ? INT_MAX : (int)((int64_t)durationMs * sample_rate / 1000);
+            int regionFirst, regionFrameCount;
+            regionFrames(region, frames, sample_rate, &regionFirst, &regionFrameCount);
+            start = regionFirst;
+            if(region.length > 0)
+                end = start + regionFrameCount;
+        }
+    }
+
+    size_t position = 0;
+    size_t fed = 0;
+    while(!reader.IsFinished() && position < end){
+        const int16_t* data = nullptr;
+        size_t size = 0;
+        if(!reader.Read(&data, &size)){
+            std::cerr << "Couldn't decode " << path << ": " << reader.GetError() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        size_t from = std::max(position, start);
+        size_t to = std::min(position + size, end);
+        if(to > from){
+            consume(data + (from - position), to - from);
+            fed += to - from;
+        }
+        position += size;
+    }
+    *first = start;
+    return fed;
+}
+#else
+static void missingFFmpeg(const char* path){
+    std::cerr << "Can't read " << path << ", IntroMark was built without FFmpeg" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// Other files still go to the stubs below so they fail with a clear message instead of AudioFile's wav error
+bool isStreamedFile(const char* path){
+    return !isPCMFile(path);
+}
+
+int probeSampleRate(const char* path){
+    missingFFmpeg(path);
+    return -1;
+}
+
+size_t streamAudioFile(const char* path, int, AudioRegion,
+    const std::function<void(const int16_t*, size_t)>&, size_t*){
+    missingFFmpeg(path);
+    return 0;
+}
+#endif
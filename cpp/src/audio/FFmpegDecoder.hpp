@@ -0,0 +1,22 @@
+#ifndef DEFINED_FFMPEGDECODER_HPP
+#define DEFINED_FFMPEGDECODER_HPP
+#include "RawAudio.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// True when path goes through FFmpeg and is streamed into the fingerprinter instead of loaded whole
+// Needs a build with FFmpeg, wav and aiff files are always read directly
+bool isStreamedFile(const char* path);
+
+// Sample rate of the audio stream in path, exits if it can't be opened
+int probeSampleRate(const char* path);
+
+// Decodes the part of path inside region to mono int16_t at sample_rate and hands it to consume block by block,
+// nothing but the block being converted is ever held in memory
+// Tail regions are found from the duration the container reports. first gets the frame the region starts at
+// and the return value is the number of frames passed to consume. Exits if the file can't be decoded
+size_t streamAudioFile(const char* path, int sample_rate, AudioRegion region,
+    const std::function<void(const int16_t*, size_t)>& consume, size_t* first);
+
+#endif
@@ -0,0 +1,127 @@
+#include "MappedWav.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint32_t readLE32(const uint8_t* p){
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static uint16_t readLE16(const uint8_t* p){
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static bool parseWav(const uint8_t* file, size_t size, MappedWav* out){
+    if(size < 12 || memcmp(file, "RIFF", 4) || memcmp(file + 8, "WAVE", 4))
+        return false;
+
+    const uint8_t* fmt = nullptr; size_t fmtSize = 0;
+    const uint8_t* data = nullptr; size_t dataSize = 0;
+    size_t pos = 12;
+    while(pos + 8 <= size && !data){
+        const uint8_t* chunk = file + pos;
+        size_t chunkSize = readLE32(chunk + 4);
+        size_t available = size - pos - 8;
+        if(!memcmp(chunk, "fmt ", 4)){
+            fmt = chunk + 8; fmtSize = std::min(chunkSize, available);
+        }
+        else if(!memcmp(chunk, "data", 4)){
+            // Streamed wavs often leave the data size as 0 or 0xFFFFFFFF, so trust the file size
+            data = chunk + 8; dataSize = (chunkSize == 0 || chunkSize > available) ? available : chunkSize;
+        }
+        // Chunks are word aligned
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    // data before fmt is allowed by the spec but nobody writes it
+    if(!fmt || !data || fmtSize < 16)
+        return false;
+
+    out->audioFormat = readLE16(fmt);
+    out->channels = readLE16(fmt + 2);
+    out->sample_rate = (int)readLE32(fmt + 4);
+    out->blockAlign = readLE16(fmt + 12);
+    out->bitDepth = readLE16(fmt + 14);
+    // The real format of an extensible wav is the first two bytes of its sub format GUID
+    if(out->audioFormat == wavFormatExtensible && fmtSize >= 26)
+        out->audioFormat = readLE16(fmt + 24);
+
+    if(out->channels < 1 || out->sample_rate <= 0 || out->blockAlign != out->channels * (out->bitDepth / 8))
+        return false;
+
+    out->data = data;
+    out->dataSize = dataSize - dataSize % out->blockAlign;
+    return true;
+}
+
+bool mapWavFile(const char* path, MappedWav* out){
+#ifdef _WIN32
+    return false;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size <= 0){
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+    // Everything downstream reads the samples front to back
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    *out = (struct MappedWav){mapping, size, nullptr, 0, 0, 0, 0, 0, 0};
+    if(!parseWav((const uint8_t*)mapping, size, out)){
+        unmapWavFile(out);
+        return false;
+    }
+    return true;
+#endif
+}
+
+void unmapWavFile(MappedWav* wav){
+#ifndef _WIN32
+    if(wav->mapping)
+        munmap(wav->mapping, wav->mappingSize);
+#endif
+    wav->mapping = nullptr;
+    wav->mappingSize = 0;
+    wav->data = nullptr;
+    wav->dataSize = 0;
+}
+
+void prefetchWavRange(const MappedWav& wav, size_t offset, size_t size){
+#ifndef _WIN32
+    if(!size)
+        return;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)(wav.data + offset) / page * page;
+    madvise((void*)begin, (uintptr_t)(wav.data + offset + size) - begin, MADV_WILLNEED);
+#endif
+}
+
+void evictWavRange(const MappedWav& wav, size_t offset, size_t size){
+#ifndef _WIN32
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = ((uintptr_t)(wav.data + offset) + page - 1) / page * page;
+    uintptr_t end = (uintptr_t)(wav.data + offset + size) / page * page;
+    if(end > begin)
+        madvise((void*)begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+bool isDirectPCM16(const MappedWav& wav){
+    return std::endian::native == std::endian::little
+        && wav.audioFormat == wavFormatPCM
+        && wav.bitDepth == 16
+        && ((uintptr_t)wav.data % alignof(int16_t)) == 0;
+}
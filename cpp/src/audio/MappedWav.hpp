@@ -0,0 +1,39 @@
+#ifndef DEFINED_MAPPEDWAV_HPP
+#define DEFINED_MAPPEDWAV_HPP
+#include <cstddef>
+#include <cstdint>
+
+// Wav format tags from the fmt chunk
+constexpr int wavFormatPCM = 1;
+constexpr int wavFormatFloat = 3;
+constexpr int wavFormatExtensible = 0xFFFE;
+
+// A wav file mapped read-only into memory, the samples are never copied
+// data points at the first byte of the data chunk inside the mapping
+// Fields left out of an initializer are empty, unmapping only needs the mapping
+struct MappedWav{
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const uint8_t* data = nullptr;
+    size_t dataSize = 0;
+    int audioFormat = 0;
+    int channels = 0;
+    int sample_rate = 0;
+    int bitDepth = 0;
+    int blockAlign = 0;
+};
+
+// Maps path and parses the RIFF/fmt/data chunks in place
+// Returns false if the file can't be mapped or isn't a wav we understand
+bool mapWavFile(const char* path, MappedWav* out);
+void unmapWavFile(MappedWav* wav);
+
+// Starts reading size bytes of the data chunk from offset, for callers that only need part of it
+void prefetchWavRange(const MappedWav& wav, size_t offset, size_t size);
+// Drops the whole pages inside size bytes of the data chunk from offset, they are read back from the file if touched again
+void evictWavRange(const MappedWav& wav, size_t offset, size_t size);
+
+// True when the data chunk can be handed out directly as interleaved int16_t samples
+bool isDirectPCM16(const MappedWav& wav);
+
+#endif
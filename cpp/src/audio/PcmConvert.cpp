@@ -0,0 +1,207 @@
+#include "PcmConvert.hpp"
+#include <bit>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#define PCM_CONVERT_X86
+#include <immintrin.h>
+#endif
+
+static void pcm24Scalar(const uint8_t* in, int16_t* out, size_t count){
+    for(size_t i = 0; i < count; i++){
+        // Shifting the top byte into place and back down sign extends it
+        int32_t sample = (int32_t)((uint32_t)in[3*i] << 8 | (uint32_t)in[3*i+1] << 16 | (uint32_t)in[3*i+2] << 24) >> 8;
+        out[i] = scaleToInt16((float)sample / 8388608.f);
+    }
+}
+
+static void pcm32Scalar(const uint8_t* in, int16_t* out, size_t count){
+    for(size_t i = 0; i < count; i++){
+        int32_t sample;
+        memcpy(&sample, in + 4*i, 4);
+        out[i] = scaleToInt16((float)sample / 2147483648.f);
+    }
+}
+
+static void float32Scalar(const uint8_t* in, int16_t* out, size_t count){
+    for(size_t i = 0; i < count; i++){
+        float sample;
+        memcpy(&sample, in + 4*i, 4);
+        out[i] = scaleToInt16(sample);
+    }
+}
+
+#ifdef PCM_CONVERT_X86
+/*
+The kernels round like roundf without SSE4.1: truncate, then step one away from zero
+when the part cut off is at least a half. The difference between a float and its truncation is exact.
+Dividing by a power of two is the same as multiplying by its inverse, so the scaling matches the scalar loops.
+*/
+__attribute__((target("sse2")))
+static inline __m128i roundToInt32SSE2(__m128 sample){
+    __m128 scaled = _mm_mul_ps(sample, _mm_set1_ps(32767.f));
+    scaled = _mm_min_ps(scaled, _mm_set1_ps(32767.f));
+    scaled = _mm_max_ps(scaled, _mm_set1_ps(-32768.f));
+    __m128i truncated = _mm_cvttps_epi32(scaled);
+    __m128 rest = _mm_sub_ps(scaled, _mm_cvtepi32_ps(truncated));
+    // Compare masks are -1, so subtracting one steps up and adding the other steps down
+    __m128i up = _mm_castps_si128(_mm_cmpge_ps(rest, _mm_set1_ps(0.5f)));
+    __m128i down = _mm_castps_si128(_mm_cmple_ps(rest, _mm_set1_ps(-0.5f)));
+    return _mm_add_epi32(_mm_sub_epi32(truncated, up), down);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i roundToInt32AVX2(__m256 sample){
+    __m256 scaled = _mm256_mul_ps(sample, _mm256_set1_ps(32767.f));
+    scaled = _mm256_min_ps(scaled, _mm256_set1_ps(32767.f));
+    scaled = _mm256_max_ps(scaled, _mm256_set1_ps(-32768.f));
+    __m256i truncated = _mm256_cvttps_epi32(scaled);
+    __m256 rest = _mm256_sub_ps(scaled, _mm256_cvtepi32_ps(truncated));
+    __m256i up = _mm256_castps_si256(_mm256_cmp_ps(rest, _mm256_set1_ps(0.5f), _CMP_GE_OQ));
+    __m256i down = _mm256_castps_si256(_mm256_cmp_ps(rest, _mm256_set1_ps(-0.5f), _CMP_LE_OQ));
+    return _mm256_add_epi32(_mm256_sub_epi32(truncated, up), down);
+}
+
+// packs works within 128 bit lanes, the permute puts the eight samples of a back in front of b
+__attribute__((target("avx2")))
+static inline void storeInt16AVX2(int16_t* out, __m256i a, __m256i b){
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+    _mm256_storeu_si256((__m256i*)out, packed);
+}
+
+__attribute__((target("sse2")))
+static void pcm32SSE2(const uint8_t* in, int16_t* out, size_t count){
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in + 4*i))), scale);
+        __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in + 4*i + 16))), scale);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(roundToInt32SSE2(a), roundToInt32SSE2(b)));
+    }
+    pcm32Scalar(in + 4*i, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void float32SSE2(const uint8_t* in, int16_t* out, size_t count){
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m128 a = _mm_loadu_ps((const float*)(in + 4*i));
+        __m128 b = _mm_loadu_ps((const float*)(in + 4*i + 16));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(roundToInt32SSE2(a), roundToInt32SSE2(b)));
+    }
+    float32Scalar(in + 4*i, out + i, count - i);
+}
+
+// Moves the three bytes of each sample to the top of an int32, an arithmetic shift then sign extends it
+// Four samples are read from the first twelve bytes of a sixteen byte load
+__attribute__((target("ssse3")))
+static inline __m128 load24SSSE3(const uint8_t* in){
+    const __m128i spread = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    __m128i samples = _mm_srai_epi32(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), spread), 8);
+    return _mm_mul_ps(_mm_cvtepi32_ps(samples), _mm_set1_ps(1.f / 8388608.f));
+}
+
+__attribute__((target("ssse3")))
+static void pcm24SSSE3(const uint8_t* in, int16_t* out, size_t count){
+    size_t i = 0;
+    // The last load reads 16 bytes from sample i + 4, past the 24 bytes being converted
+    for(; i + 10 <= count; i += 8){
+        __m128i a = roundToInt32SSE2(load24SSSE3(in + 3*i));
+        __m128i b = roundToInt32SSE2(load24SSSE3(in + 3*i + 12));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+    }
+    pcm24Scalar(in + 3*i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 load24AVX2(const uint8_t* in){
+    const __m256i spread = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    __m256i bytes = _mm256_loadu2_m128i((const __m128i*)(in + 12), (const __m128i*)in);
+    __m256i samples = _mm256_srai_epi32(_mm256_shuffle_epi8(bytes, spread), 8);
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(samples), _mm256_set1_ps(1.f / 8388608.f));
+}
+
+__attribute__((target("avx2")))
+static void pcm24AVX2(const uint8_t* in, int16_t* out, size_t count){
+    size_t i = 0;
+    for(; i + 18 <= count; i += 16){
+        __m256i a = roundToInt32AVX2(load24AVX2(in + 3*i));
+        __m256i b = roundToInt32AVX2(load24AVX2(in + 3*i + 24));
+        storeInt16AVX2(out + i, a, b);
+    }
+    pcm24Scalar(in + 3*i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void pcm32AVX2(const uint8_t* in, int16_t* out, size_t count){
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16){
+        __m256 a = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(in + 4*i))), scale);
+        __m256 b = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(in + 4*i + 32))), scale);
+        storeInt16AVX2(out + i, roundToInt32AVX2(a), roundToInt32AVX2(b));
+    }
+    pcm32Scalar(in + 4*i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void float32AVX2(const uint8_t* in, int16_t* out, size_t count){
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16){
+        __m256 a = _mm256_loadu_ps((const float*)(in + 4*i));
+        __m256 b = _mm256_loadu_ps((const float*)(in + 4*i + 32));
+        storeInt16AVX2(out + i, roundToInt32AVX2(a), roundToInt32AVX2(b));
+    }
+    float32Scalar(in + 4*i, out + i, count - i);
+}
+#endif
+
+std::vector<ConvertKernels> convertKernels(){
+    std::vector<ConvertKernels> supported = {(struct ConvertKernels){"scalar", pcm24Scalar, pcm32Scalar, float32Scalar}};
+#ifdef PCM_CONVERT_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2"))
+        supported.push_back((struct ConvertKernels){"sse2", pcm24Scalar, pcm32SSE2, float32SSE2});
+    if(__builtin_cpu_supports("ssse3"))
+        supported.push_back((struct ConvertKernels){"ssse3", pcm24SSSE3, pcm32SSE2, float32SSE2});
+    if(__builtin_cpu_supports("avx2"))
+        supported.push_back((struct ConvertKernels){"avx2", pcm24AVX2, pcm32AVX2, float32AVX2});
+#endif
+    return supported;
+}
+
+static const ConvertKernels kernels = convertKernels().back();
+
+bool canConvertToInt16(const MappedWav& wav){
+    if(std::endian::native != std::endian::little)
+        return false;
+    if(wav.audioFormat == wavFormatPCM)
+        return wav.bitDepth == 8 || wav.bitDepth == 16 || wav.bitDepth == 24 || wav.bitDepth == 32;
+    return wav.audioFormat == wavFormatFloat && wav.bitDepth == 32;
+}
+
+void convertToInt16(const MappedWav& wav, size_t firstFrame, size_t frames, int16_t* out){
+    const uint8_t* in = wav.data + firstFrame*wav.blockAlign;
+    size_t count = frames*wav.channels;
+    if(wav.audioFormat == wavFormatFloat){
+        kernels.float32(in, out, count);
+        return;
+    }
+    switch(wav.bitDepth){
+        case 8:
+            // 8 bit wavs are unsigned
+            for(size_t i = 0; i < count; i++)
+                out[i] = scaleToInt16((float)(in[i] - 128) / 128.f);
+            break;
+        case 16:
+            memcpy(out, in, count*sizeof(int16_t));
+            break;
+        case 24:
+            kernels.pcm24(in, out, count);
+            break;
+        case 32:
+            kernels.pcm32(in, out, count);
+            break;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef DEFINED_PCMCONVERT_HPP
+#define DEFINED_PCMCONVERT_HPP
+#include "MappedWav.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <math.h>
+#include <vector>
+
+// True when the samples of wav can be turned into int16_t straight from the mapping
+// Covers 8, 16, 24 and 32 bit PCM and 32 bit float
+bool canConvertToInt16(const MappedWav& wav);
+
+// Writes frames interleaved int16_t frames starting at firstFrame to out
+// 16 bit samples are copied as they are. Unaligned ones used to go through AudioFile<float>,
+// which moved samples past about half scale one step towards zero, so their fingerprints differ from before
+// The rest are scaled to [-1, 1] as floats, multiplied by 32767 and rounded half away from zero like AudioFile<float> did
+// Uses AVX2, SSSE3 or SSE2 when the cpu has them, picked once at runtime
+void convertToInt16(const MappedWav& wav, size_t firstFrame, size_t frames, int16_t* out);
+
+// A sample scaled to [-1, 1] as int16_t, every kernel gives the same result
+// Out of range floats saturate, NaN ends up at full scale like min and max do in SSE
+inline int16_t scaleToInt16(float sample){
+    float scaled = sample * 32767.f;
+    scaled = scaled < 32767.f ? scaled : 32767.f;
+    scaled = scaled > -32768.f ? scaled : -32768.f;
+    return (int16_t)roundf(scaled);
+}
+
+typedef void (*ConvertKernel)(const uint8_t* in, int16_t* out, size_t count);
+
+struct ConvertKernels{
+    const char* name;
+    ConvertKernel pcm24;
+    ConvertKernel pcm32;
+    ConvertKernel float32;
+};
+
+// Every kernel set this cpu can run, scalar first and the fastest last, convertToInt16 uses the last one
+std::vector<ConvertKernels> convertKernels();
+
+#endif
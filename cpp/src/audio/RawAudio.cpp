@@ -1,65 +1,130 @@
 #include "AudioFile.h"
+#include "MappedWav.hpp"
+#include "PcmConvert.hpp"
 #include "RawAudio.hpp"
+#include "SampleCompare.hpp"
+#include "Silence.hpp"
+#include <algorithm>
+#include <math.h>
 #include <vector>
 using std::vector;
 
 void freeRawAudio(RawAudio* input){
     if(!input->deleted){
-        delete[] input->arr;
+        if(input->mapping){
+            MappedWav wav = {.mapping = input->mapping, .mappingSize = input->mappingSize};
+            unmapWavFile(&wav);
+        }
+        else{
+            delete[] input->arr;
+        }
         input->silence.clear();
         input->deleted = true;
     }
 }
 
-RawAudio audioFileToArr(char * path){
+void releaseSamples(const RawAudio& audio, size_t first, size_t count){
+    if(audio.deleted || !audio.mapping)
+        return;
+    MappedWav wav = {.mapping = audio.mapping, .mappingSize = audio.mappingSize, .data = (const uint8_t*)audio.arr};
+    evictWavRange(wav, first*sizeof(int16_t), count*sizeof(int16_t));
+}
+
+void regionFrames(AudioRegion region, int frames, int sample_rate, int* first, int* count){
+    int64_t start = (int64_t)(region.start * sample_rate);
+    if(region.start < 0)
+        start += frames;
+    start = std::clamp<int64_t>(start, 0, frames);
+    int64_t end = frames;
+    if(region.length > 0)
+        end = std::min<int64_t>(frames, start + (int64_t)(region.length * sample_rate));
+    *first = (int)start;
+    *count = (int)(end - start);
+}
+
+static void shiftRanges(vector<TimeRange>& ranges, double offset){
+    for(TimeRange& range : ranges){
+        range.start += offset;
+        range.end += offset;
+    }
+}
+
+// Silence is relative to the first frame read and gets moved to file time
+static RawAudio makeRawAudio(const int16_t* arr, SilenceDetector& detector, char * path, int sample_rate, int channels, int first, int samples, void* mapping, size_t mappingSize){
+    double offsetSec = (double)first/sample_rate;
+    vector<TimeRange> silentRanges = detector.finish();
+    shiftRanges(silentRanges, offsetSec);
+    return (struct RawAudio){arr, silentRanges, path, sample_rate, channels, samples*channels, (double)samples/sample_rate, offsetSec, false, mapping, mappingSize};
+}
+
+// Fallback for files that aren't wavs we can map, decodes through AudioFile
+static RawAudio decodeAudioFile(char * path, AudioRegion region){
     AudioFile<float> audioFile;
     if(!audioFile.load(path)){
         exit (EXIT_FAILURE);
     }
     
-    int samples = audioFile.getNumSamplesPerChannel();
     int channels = audioFile.getNumChannels();
     int sample_rate = (int)audioFile.getSampleRate();
+    int first, samples;
+    regionFrames(region, audioFile.getNumSamplesPerChannel(), sample_rate, &first, &samples);
 
     int16_t* arr = new int16_t[samples*channels];
-    vector<TimeRange> silentRanges;
-
     int index = 0;
-    int silenceStart=0; int silenceEnd=0;
-    for (int i = 0; i < samples; i++){
-        double volume = 0;
+    for (int i = first; i < first + samples; i++){
         for(int j = 0; j < channels; j++){
-            volume += abs(audioFile.samples[j][i]);
             arr[index] = round(audioFile.samples[j][i] * 32767); 
             index++;
         }
-        silenceEnd++;
-        if(volume/channels > 0.01){
-            if(silenceEnd - silenceStart > sample_rate*silenceThreshold){
-                silentRanges.push_back((struct TimeRange){
-                    (double) silenceStart/sample_rate, 
-                    (double) silenceEnd/sample_rate 
-                });
-            }
-            silenceStart = silenceEnd;
-        }
     }
-
-    return (struct RawAudio){arr, silentRanges, path, sample_rate, channels, samples*channels, (double)samples/sample_rate, false};
+    SilenceDetector detector(sample_rate, channels);
+    detector.feed(arr, samples);
+    return makeRawAudio(arr, detector, path, sample_rate, channels, first, samples, nullptr, 0);
 }
 
-int getCommonPrefix(RawAudio audioA, RawAudio audioB){
-    for(int i=0; i<std::min(audioA.length, audioB.length); i++){
-        if(audioA.arr[i]!=audioB.arr[i])
-            return i/audioA.channels;
+RawAudio audioFileToArr(char * path, AudioRegion region){
+    MappedWav wav;
+    if(!mapWavFile(path, &wav)){
+        return decodeAudioFile(path, region);
     }
-    return std::min(audioA.length, audioB.length)/audioA.channels;
-}
-int getCommonSuffix(RawAudio audioA, RawAudio audioB){
-    int tailA = audioA.length-1; int tailB = audioB.length-1;
-    int len = 0;
-    while(tailA>=0 && tailB>=0 && audioA.arr[tailA] == audioB.arr[tailB]){
-        tailA--; tailB--; len++;
+    if(!canConvertToInt16(wav)){
+        unmapWavFile(&wav);
+        return decodeAudioFile(path, region);
+    }
+
+    // Pages outside the region are never touched, so they are never read from disk
+    int channels = wav.channels;
+    int sample_rate = wav.sample_rate;
+    int first, samples;
+    regionFrames(region, (int)(wav.dataSize / wav.blockAlign), sample_rate, &first, &samples);
+    if(!isWholeFile(region))
+        prefetchWavRange(wav, (size_t)first*wav.blockAlign, (size_t)samples*wav.blockAlign);
+
+    SilenceDetector detector(sample_rate, channels);
+    // 16 bit little endian PCM is already the layout chromaprint wants, so hand out the mapped samples
+    // Looking for silence is the first time they are read, which pulls them in from disk
+    if(isDirectPCM16(wav)){
+        const int16_t* arr = (const int16_t*)wav.data + (size_t)first*channels;
+        detector.feed(arr, samples);
+        return makeRawAudio(arr, detector, path, sample_rate, channels, first, samples, wav.mapping, wav.mappingSize);
     }
-    return len/audioA.channels;
-}
\ No newline at end of file
+
+    // Anything else is converted straight from the mapping, without a float copy of the file
+    // Silence is found block by block while the converted samples are still in cache
+    int16_t* arr = new int16_t[(size_t)samples*channels];
+    constexpr int convertBlock = 4096;
+    for(int done = 0; done < samples; done += convertBlock){
+        int frames = std::min(convertBlock, samples - done);
+        convertToInt16(wav, first + done, frames, arr + (size_t)done*channels);
+        detector.feed(arr + (size_t)done*channels, frames);
+    }
+    unmapWavFile(&wav);
+    return makeRawAudio(arr, detector, path, sample_rate, channels, first, samples, nullptr, 0);
+}
+
+int getCommonPrefix(const RawAudio& audioA, const RawAudio& audioB){
+    return (int)(commonPrefixLength(samples(audioA), samples(audioB))/audioA.channels);
+}
+int getCommonSuffix(const RawAudio& audioA, const RawAudio& audioB){
+    return (int)(commonSuffixLength(samples(audioA), samples(audioB))/audioA.channels);
+}
@@ -1,5 +1,8 @@
 #ifndef DEFINED_RAWAUDIO_HPP
 #define DEFINED_RAWAUDIO_HPP
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <vector>
 using std::vector;
 
@@ -10,21 +13,42 @@ struct TimeRange{
 
 inline bool sortByStart(TimeRange a, TimeRange b){return a.start < b.start;}
 
+// Part of a file to load, in seconds. A negative start counts back from the end of the file
+// and a length of 0 or less runs to the end
+struct AudioRegion{
+    double start;
+    double length;
+};
+constexpr AudioRegion wholeFile = {0, 0};
+inline bool isWholeFile(AudioRegion region){return region.start == 0 && region.length <= 0;}
+// First frame and number of frames of region in a file of frames frames
+void regionFrames(AudioRegion region, int frames, int sample_rate, int* first, int* count);
+
 struct RawAudio{
-    int16_t* arr;
+    const int16_t* arr;
     vector<TimeRange> silence;
     char* filename;
     int sample_rate;
     int channels;
     int length;
+    // Length of arr and where it starts in the file, everything else is in seconds from offsetSec
     double lengthSec;
+    double offsetSec;
     bool deleted;
+    // When set arr points into a read-only mapping of the file instead of a heap copy
+    void* mapping;
+    size_t mappingSize;
 };
 void freeRawAudio(RawAudio* input);
 constexpr double silenceThreshold = 0.5;
-RawAudio audioFileToArr(char * path);
-int getCommonPrefix(RawAudio audioA, RawAudio audioB);
-int getCommonSuffix(RawAudio audioA, RawAudio audioB);
+// Only the frames inside region are read, silence is reported in file time
+RawAudio audioFileToArr(char * path, AudioRegion region = wholeFile);
+inline std::span<const int16_t> samples(const RawAudio& audio){return {audio.arr, (size_t)audio.length};}
+// Done with count samples from first, a mapped file gives their memory back
+void releaseSamples(const RawAudio& audio, size_t first, size_t count);
+// Identical frames at the start/end of both files
+int getCommonPrefix(const RawAudio& audioA, const RawAudio& audioB);
+int getCommonSuffix(const RawAudio& audioA, const RawAudio& audioB);
 
 
 #endif
@@ -0,0 +1,121 @@
+#include "SampleCompare.hpp"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#define SAMPLE_COMPARE_X86
+#include <immintrin.h>
+#endif
+
+static size_t prefixScalar(const int16_t* a, const int16_t* b, size_t len){
+    size_t i = 0;
+    while(i < len && a[i] == b[i])
+        i++;
+    return i;
+}
+
+// a and b point one past the last sample
+static size_t suffixScalar(const int16_t* a, const int16_t* b, size_t len){
+    size_t i = 0;
+    while(i < len && a[-1-(ptrdiff_t)i] == b[-1-(ptrdiff_t)i])
+        i++;
+    return i;
+}
+
+#ifdef SAMPLE_COMPARE_X86
+/*
+Every kernel compares a block of samples with cmpeq and turns it into a byte mask,
+two mask bits per sample. The first zero bit from the bottom is the first mismatch of a prefix,
+the first zero bit from the top is the last mismatch of a suffix.
+*/
+__attribute__((target("sse2")))
+static size_t prefixSSE2(const int16_t* a, const int16_t* b, size_t len){
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8){
+        __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+        if(mask != 0xFFFF)
+            return i + __builtin_ctz(~mask) / 2;
+    }
+    return i + prefixScalar(a + i, b + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static size_t suffixSSE2(const int16_t* a, const int16_t* b, size_t len){
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8){
+        __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(a - i - 8)), _mm_loadu_si128((const __m128i*)(b - i - 8)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+        if(mask != 0xFFFF)
+            return i + (__builtin_clz(~mask << 16)) / 2;
+    }
+    return i + suffixScalar(a - i, b - i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t prefixAVX2(const int16_t* a, const int16_t* b, size_t len){
+    size_t i = 0;
+    // 32 samples per step, the two compares are combined so the loop has a single branch
+    for(; i + 32 <= len; i += 32){
+        __m256i eq0 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i eq1 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(a + i + 16)), _mm256_loadu_si256((const __m256i*)(b + i + 16)));
+        if((unsigned)_mm256_movemask_epi8(_mm256_and_si256(eq0, eq1)) != 0xFFFFFFFFu){
+            unsigned mask0 = (unsigned)_mm256_movemask_epi8(eq0);
+            if(mask0 != 0xFFFFFFFFu)
+                return i + __builtin_ctz(~mask0) / 2;
+            unsigned mask1 = (unsigned)_mm256_movemask_epi8(eq1);
+            return i + 16 + __builtin_ctz(~mask1) / 2;
+        }
+    }
+    for(; i + 16 <= len; i += 16){
+        __m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(eq);
+        if(mask != 0xFFFFFFFFu)
+            return i + __builtin_ctz(~mask) / 2;
+    }
+    return i + prefixScalar(a + i, b + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t suffixAVX2(const int16_t* a, const int16_t* b, size_t len){
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32){
+        __m256i eq0 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(a - i - 16)), _mm256_loadu_si256((const __m256i*)(b - i - 16)));
+        __m256i eq1 = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(a - i - 32)), _mm256_loadu_si256((const __m256i*)(b - i - 32)));
+        if((unsigned)_mm256_movemask_epi8(_mm256_and_si256(eq0, eq1)) != 0xFFFFFFFFu){
+            unsigned mask0 = (unsigned)_mm256_movemask_epi8(eq0);
+            if(mask0 != 0xFFFFFFFFu)
+                return i + __builtin_clz(~mask0) / 2;
+            unsigned mask1 = (unsigned)_mm256_movemask_epi8(eq1);
+            return i + 16 + __builtin_clz(~mask1) / 2;
+        }
+    }
+    for(; i + 16 <= len; i += 16){
+        __m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(a - i - 16)), _mm256_loadu_si256((const __m256i*)(b - i - 16)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(eq);
+        if(mask != 0xFFFFFFFFu)
+            return i + __builtin_clz(~mask) / 2;
+    }
+    return i + suffixScalar(a - i, b - i, len - i);
+}
+#endif
+
+std::vector<CompareKernels> compareKernels(){
+    std::vector<CompareKernels> supported = {(struct CompareKernels){"scalar", prefixScalar, suffixScalar}};
+#ifdef SAMPLE_COMPARE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2"))
+        supported.push_back((struct CompareKernels){"sse2", prefixSSE2, suffixSSE2});
+    if(__builtin_cpu_supports("avx2"))
+        supported.push_back((struct CompareKernels){"avx2", prefixAVX2, suffixAVX2});
+#endif
+    return supported;
+}
+
+static const CompareKernels kernels = compareKernels().back();
+
+size_t commonPrefixLength(std::span<const int16_t> a, std::span<const int16_t> b){
+    return kernels.prefix(a.data(), b.data(), std::min(a.size(), b.size()));
+}
+
+size_t commonSuffixLength(std::span<const int16_t> a, std::span<const int16_t> b){
+    return kernels.suffix(a.data() + a.size(), b.data() + b.size(), std::min(a.size(), b.size()));
+}
@@ -0,0 +1,26 @@
+#ifndef DEFINED_SAMPLECOMPARE_HPP
+#define DEFINED_SAMPLECOMPARE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Number of samples at the start of a and b that are identical
+// Uses AVX2 or SSE2 when the cpu has them, picked once at runtime
+size_t commonPrefixLength(std::span<const int16_t> a, std::span<const int16_t> b);
+// Number of samples at the end of a and b that are identical
+size_t commonSuffixLength(std::span<const int16_t> a, std::span<const int16_t> b);
+
+// a and b point at the first sample for prefix and one past the last for suffix, len samples are compared
+typedef size_t (*CompareKernel)(const int16_t* a, const int16_t* b, size_t len);
+
+struct CompareKernels{
+    const char* name;
+    CompareKernel prefix;
+    CompareKernel suffix;
+};
+
+// Every kernel pair this cpu can run, scalar first and the fastest last, the functions above use the last one
+std::vector<CompareKernels> compareKernels();
+
+#endif
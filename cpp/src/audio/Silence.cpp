@@ -0,0 +1,118 @@
+#include "Silence.hpp"
+#include <algorithm>
+#include <stdlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#define SILENCE_X86
+#include <immintrin.h>
+#endif
+
+static uint64_t levelScalar(const int16_t* samples, size_t count){
+    uint64_t level = 0;
+    for(size_t i = 0; i < count; i++)
+        level += abs(samples[i]);
+    return level;
+}
+
+#ifdef SILENCE_X86
+/*
+Absolute values are summed as unsigned 16 bit numbers so -32768 comes out as 32768,
+then widened to 32 bit lanes. Every step adds two magnitudes to each lane and the lanes are added
+to the total every 8192 steps, so a lane sums at most 16384 values and stays at or below 2^29.
+*/
+constexpr size_t laneFlush = 8192;
+
+__attribute__((target("sse2")))
+static uint64_t levelSSE2(const int16_t* samples, size_t count){
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t level = 0;
+    size_t i = 0;
+    while(i + 8 <= count){
+        size_t end = std::min(count - count % 8, i + 8*laneFlush);
+        __m128i sum = zero;
+        for(; i < end; i += 8){
+            __m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+            __m128i sign = _mm_srai_epi16(x, 15);
+            __m128i magnitude = _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+            sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(magnitude, zero));
+            sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(magnitude, zero));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, sum);
+        level += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return level + levelScalar(samples + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static uint64_t levelAVX2(const int16_t* samples, size_t count){
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t level = 0;
+    size_t i = 0;
+    while(i + 16 <= count){
+        size_t end = std::min(count - count % 16, i + 16*laneFlush);
+        __m256i sum = zero;
+        for(; i < end; i += 16){
+            __m256i magnitude = _mm256_abs_epi16(_mm256_loadu_si256((const __m256i*)(samples + i)));
+            sum = _mm256_add_epi32(sum, _mm256_unpacklo_epi16(magnitude, zero));
+            sum = _mm256_add_epi32(sum, _mm256_unpackhi_epi16(magnitude, zero));
+        }
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, sum);
+        for(uint32_t lane : lanes)
+            level += lane;
+    }
+    return level + levelScalar(samples + i, count - i);
+}
+#endif
+
+std::vector<LevelKernels> levelKernels(){
+    std::vector<LevelKernels> supported = {(struct LevelKernels){"scalar", levelScalar}};
+#ifdef SILENCE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2"))
+        supported.push_back((struct LevelKernels){"sse2", levelSSE2});
+    if(__builtin_cpu_supports("avx2"))
+        supported.push_back((struct LevelKernels){"avx2", levelAVX2});
+#endif
+    return supported;
+}
+
+static const LevelKernel levelKernel = levelKernels().back().level;
+
+SilenceDetector::SilenceDetector(int sample_rate, int channels)
+    : sample_rate(sample_rate), channels(channels), blockFrames(std::max(1, sample_rate/100)) {}
+
+void SilenceDetector::feed(const int16_t* samples, size_t frames){
+    while(frames > 0){
+        size_t take = std::min(frames, blockFrames - blockFill);
+        blockLevel += levelKernel(samples, take*channels);
+        blockFill += take;
+        samples += take*channels;
+        frames -= take;
+        if(blockFill == blockFrames)
+            endBlock();
+    }
+}
+
+void SilenceDetector::endBlock(){
+    bool blockQuiet = blockLevel*100 <= 32768ULL*channels*blockFill;
+    if(blockQuiet && !quiet){
+        quietStart = blockStart;
+    }
+    else if(!blockQuiet && quiet && blockStart - quietStart >= sample_rate*silenceThreshold){
+        silences.push_back((struct TimeRange){(double)quietStart/sample_rate, (double)blockStart/sample_rate});
+    }
+    quiet = blockQuiet;
+    blockStart += blockFill;
+    blockFill = 0;
+    blockLevel = 0;
+}
+
+std::vector<TimeRange> SilenceDetector::finish(){
+    if(blockFill > 0)
+        endBlock();
+    if(quiet && blockStart - quietStart >= sample_rate*silenceThreshold)
+        silences.push_back((struct TimeRange){(double)quietStart/sample_rate, (double)blockStart/sample_rate});
+    quiet = false;
+    return silences;
+}
@@ -0,0 +1,47 @@
+#ifndef DEFINED_SILENCE_HPP
+#define DEFINED_SILENCE_HPP
+#include "RawAudio.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Finds silences while the audio is being read, without a second pass over it
+// Audio is cut into 10ms blocks, a block is quiet when its mean absolute amplitude is at most 1% of full scale
+// and runs of quiet blocks at least silenceThreshold seconds long are silences
+class SilenceDetector{
+public:
+    SilenceDetector(int sample_rate, int channels);
+
+    // Takes interleaved frames in order, they don't have to line up with blocks
+    void feed(const int16_t* samples, size_t frames);
+
+    // Ends the last block and returns the silences in seconds from the first frame fed
+    // A silence running to the end of the audio counts too
+    std::vector<TimeRange> finish();
+
+private:
+    void endBlock();
+
+    int sample_rate;
+    int channels;
+    size_t blockFrames;
+    size_t blockStart = 0;
+    size_t blockFill = 0;
+    uint64_t blockLevel = 0;
+    bool quiet = false;
+    size_t quietStart = 0;
+    std::vector<TimeRange> silences;
+};
+
+// Sum of the absolute values of count samples, -32768 counts as 32768
+typedef uint64_t (*LevelKernel)(const int16_t* samples, size_t count);
+
+struct LevelKernels{
+    const char* name;
+    LevelKernel level;
+};
+
+// Every level kernel this cpu can run, scalar first and the fastest last, SilenceDetector uses the last one
+std::vector<LevelKernels> levelKernels();
+
+#endif
@@ -0,0 +1,20 @@
+#include "chromaprint_setup.hpp"
+#include <fingerprinter_configuration.h>
+#include <mutex>
+
+static std::mutex setupMutex;
+
+ChromaprintContext* newChromaprintContext(int algorithm, int sample_rate){
+    std::lock_guard<std::mutex> lock(setupMutex);
+    return chromaprint_new(algorithm, sample_rate);
+}
+
+chromaprint::Fingerprinter* newFingerprinter(int algorithm, int sample_rate){
+    std::lock_guard<std::mutex> lock(setupMutex);
+    return new chromaprint::Fingerprinter(chromaprint::CreateFingerprinterConfiguration(algorithm, sample_rate));
+}
+
+chromaprint::FingerprinterConfiguration* newFingerprinterConfiguration(int algorithm, int sample_rate){
+    std::lock_guard<std::mutex> lock(setupMutex);
+    return chromaprint::CreateFingerprinterConfiguration(algorithm, sample_rate);
+}
@@ -0,0 +1,15 @@
+#ifndef DEFINED_CHROMAPRINT_SETUP_HPP
+#define DEFINED_CHROMAPRINT_SETUP_HPP
+#include <chromaprint.h>
+#include <fingerprinter.h>
+
+// CreateFingerprinterConfiguration writes a global sample rate inside chromaprint,
+// so everything that makes a configuration goes through here and is created one at a time
+
+ChromaprintContext* newChromaprintContext(int algorithm, int sample_rate);
+
+chromaprint::Fingerprinter* newFingerprinter(int algorithm, int sample_rate);
+
+chromaprint::FingerprinterConfiguration* newFingerprinterConfiguration(int algorithm, int sample_rate);
+
+#endif
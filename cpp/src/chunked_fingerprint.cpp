@@ -0,0 +1,123 @@
+#include "chunked_fingerprint.hpp"
+#include <chromaprint_setup.hpp>
+#include <fingerprint_calculator.h>
+#include <fingerprinter.h>
+#include <fingerprinter_configuration.h>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+The uint32 stream can't be cut and rejoined, every subfingerprint reads a rolling
+integral image of running double sums over all the rows before it.
+Everything before that only looks at a few seconds of audio though
+
+    resampled sample n    input samples around n * sample_rate / internal rate
+    FFT frame k           resampled samples [k*hop, k*hop + frameSize)
+    feature row r         FFT frames [r, r + filterLength)
+
+so a fresh fingerprinter started on one of Fingerprinter::GetRestartPoints makes exactly the
+rows of the serial run, apart from the first few the resampler warms up on.
+When resampling up the restart points are a few minutes apart, short files aren't split.
+Each chunk collects its normalized rows and they are joined in order into one FingerprintCalculator.
+*/
+
+// Keeps the normalized rows [first, last) of one chunk back to back, every row is rowSize long
+class RowCollector : public chromaprint::FeatureVectorConsumer{
+public:
+    std::vector<chromaprint::Real> rows;
+    size_t rowSize = 0;
+
+    RowCollector(int first, int last): first(first), last(last) {}
+    void Consume(chromaprint::FeatureSpan features) override{
+        rowSize = features.size();
+        if(index >= first && index < last)
+            rows.insert(rows.end(), features.begin(), features.end());
+        index++;
+    }
+
+private:
+    int first, last;
+    int index = 0;
+};
+
+static void feed(chromaprint::Fingerprinter* fingerprinter, const int16_t* samples, int frames, int sample_rate, int channels){
+    fingerprinter->Start(sample_rate, channels);
+    fingerprinter->Consume(samples, frames * channels);
+    fingerprinter->Finish();
+}
+
+static ChromaArr copyFingerprint(const std::vector<uint32_t>& fingerprint){
+    ChromaArr chroma = (struct ChromaArr){(uint32_t*)malloc(sizeof(uint32_t) * std::max<size_t>(fingerprint.size(), 1)),
+        (int)fingerprint.size(), false, nullptr, 0};
+    std::copy(fingerprint.begin(), fingerprint.end(), chroma.arr);
+    return chroma;
+}
+
+ChromaArr fingerprintChunked(const int16_t* samples, int frames, int sample_rate, int channels, int algorithm,
+    int chunks, int* delay, int* item_duration){
+    std::unique_ptr<chromaprint::Fingerprinter> main(newFingerprinter(algorithm, sample_rate));
+    const chromaprint::FingerprinterConfiguration* config = main->config();
+    *delay = config->delay();
+    *item_duration = config->item_duration();
+
+    int inputStep, rowStep, skipRows, lookahead;
+    if(chunks <= 1 || !main->GetRestartPoints(sample_rate, &inputStep, &rowStep, &skipRows, &lookahead)){
+        feed(main.get(), samples, frames, sample_rate, channels);
+        return copyFingerprint(main->GetFingerprint());
+    }
+
+    int64_t hop = config->frame_size() - config->frame_overlap();
+    int filterLength = config->num_filter_coefficients();
+    // Rows, and resampled samples per input frame, are rowStep/inputStep and rowStep*hop/inputStep
+    int64_t rows = (int64_t)frames * rowStep / inputStep;
+    // Restart points need lookahead frames after them
+    int64_t restarts = std::max<int64_t>(frames - lookahead, 0) / inputStep;
+    // A chunk recomputes frameSize + (filterLength-1)*hop resampled samples the one before it already did,
+    // don't split finer than that
+    int64_t overlapRows = (config->frame_size() + hop - 1) / hop + filterLength + skipRows;
+    chunks = (int)std::min<int64_t>({(int64_t)chunks, restarts, rows / overlapRows});
+    if(chunks <= 1){
+        feed(main.get(), samples, frames, sample_rate, channels);
+        return copyFingerprint(main->GetFingerprint());
+    }
+
+    // Chunk c starts on restart point restart(c) and keeps the rows up to where chunk c+1's are right
+    auto restart = [&](int c){ return restarts * c / chunks; };
+    auto firstRow = [&](int c){ return c == 0 ? 0 : restart(c) * rowStep + skipRows; };
+    std::vector<std::unique_ptr<RowCollector>> collectors;
+    std::vector<std::thread> threads;
+    for(int c=0; c<chunks; c++){
+        int64_t startRow = restart(c) * rowStep;
+        int64_t start = restart(c) * inputStep;
+        int64_t end = frames;
+        int last = INT_MAX;
+        if(c < chunks-1){
+            last = (int)(firstRow(c+1) - startRow);
+            // Resampled samples up to the last frame of the last row
+            int64_t resampledEnd = (firstRow(c+1) + filterLength - 2) * hop + config->frame_size();
+            end = std::min<int64_t>(frames, resampledEnd * inputStep / (rowStep * hop) + 1 + lookahead);
+        }
+        collectors.emplace_back(new RowCollector((int)(firstRow(c) - startRow), last));
+        RowCollector* collector = collectors.back().get();
+        threads.emplace_back([=]{
+            std::unique_ptr<chromaprint::Fingerprinter> fingerprinter(newFingerprinter(algorithm, sample_rate));
+            fingerprinter->SetFeatureConsumer(collector);
+            feed(fingerprinter.get(), samples + start*channels, (int)(end - start), sample_rate, channels);
+        });
+    }
+
+    chromaprint::FingerprintCalculator calculator(config->classifiers(), config->num_classifiers());
+    for(int c=0; c<chunks; c++){
+        threads[c].join();
+        std::vector<chromaprint::Real>& collected = collectors[c]->rows;
+        size_t rowSize = collectors[c]->rowSize;
+        for(size_t offset=0; offset<collected.size(); offset+=rowSize)
+            calculator.Consume(chromaprint::FeatureSpan(collected.data()+offset, rowSize));
+        collectors[c].reset();
+    }
+    return copyFingerprint(calculator.GetFingerprint());
+}
@@ -0,0 +1,12 @@
+#ifndef DEFINED_CHUNKED_FINGERPRINT_HPP
+#define DEFINED_CHUNKED_FINGERPRINT_HPP
+#include <matcher.hpp>
+#include <cstdint>
+
+// Fingerprints frames of interleaved audio on up to chunks threads
+// The result is bit-identical to feeding everything through one chromaprint context
+// chroma.arr is allocated with malloc like chromaprint_get_raw_fingerprint
+ChromaArr fingerprintChunked(const int16_t* samples, int frames, int sample_rate, int channels, int algorithm,
+    int chunks, int* delay, int* item_duration);
+
+#endif
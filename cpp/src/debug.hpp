@@ -0,0 +1,20 @@
+#ifndef DEFINED_DEBUG_HPP
+#define DEFINED_DEBUG_HPP
+#include <iostream>
+#include <cstdlib>
+
+// Assert macro from https://stackoverflow.com/questions/3767869/adding-message-to-assert
+#ifndef NDEBUG
+#   define ASSERT(condition, message) \
+    do { \
+        if (! (condition)) { \
+            std::cerr << "Assertion `" #condition "` failed in " << __FILE__ \
+                      << " line " << __LINE__ << ": " << message << std::endl; \
+            exit(EXIT_FAILURE); \
+        } \
+    } while (false)
+#else
+#   define ASSERT(condition, message) do { } while (false)
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+#include "diagonal_merge.hpp"
+#include <gray_code.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Segment tree over list positions holding the smallest startA below every node, merged away matches hold INT_MAX
+class StartIndex{
+public:
+    explicit StartIndex(const vector<CommonSubArr>& matches){
+        while(leaves < (int)matches.size())
+            leaves *= 2;
+        minStart.assign(2*leaves, INT_MAX);
+        for(size_t i=0; i<matches.size(); i++)
+            minStart[leaves + i] = matches[i].startA;
+        for(int node = leaves - 1; node > 0; node--)
+            minStart[node] = std::min(minStart[2*node], minStart[2*node+1]);
+    }
+
+    void remove(int pos){
+        int node = pos + leaves;
+        minStart[node] = INT_MAX;
+        for(node >>= 1; node > 0; node >>= 1)
+            minStart[node] = std::min(minStart[2*node], minStart[2*node+1]);
+    }
+
+    // Last position before end whose startA is at most limit, -1 if there is none
+    int lastAtMost(int end, int limit) const{
+        return find(1, 0, leaves, end, limit);
+    }
+
+private:
+    int find(int node, int from, int to, int end, int limit) const{
+        if(from >= end || minStart[node] > limit)
+            return -1;
+        if(to - from == 1)
+            return from;
+        int mid = (from + to) / 2;
+        int right = find(2*node+1, mid, to, end, limit);
+        return right >= 0 ? right : find(2*node, from, mid, end, limit);
+    }
+
+    int leaves = 1;
+    vector<int> minStart;
+};
+
+/*
+The loop this replaces went from the last match to the first. Every match took the first earlier match in list order
+that was close enough, erased it and tried again from its new start. The search for one stopped at the first match
+starting mergeThreshold or more before it in A that was too far from it to merge
+Here the stop is found in the start index and live matches are listed per diagonal, so only the matches between
+the stop and the current one on the 2*offsetThreshold+1 diagonals around it are looked at
+*/
+vector<CommonSubArr> merge_diagonal_runs(const vector<CommonSubArr>& matches, const uint32_t* fingerprintA, const uint32_t* fingerprintB, int offsetB,
+    int mergeThreshold, int offsetThreshold){
+    // Fields agreeing over the gap before next along its diagonal. The diagonal tolerance can put the start of the gap
+    // in front of B, those positions are read from A like the concatenation and the sentinel never agrees
+    auto gapMatches = [&](const CommonSubArr& next, int gap) {
+        int inB = std::clamp(next.startB - offsetB, 0, gap);
+        int matched = gray_code_matches(fingerprintA + next.startA - inB, fingerprintB + next.startB - offsetB - inB, inB);
+        for(int j=inB+1; j<=gap; j++){
+            int pos = next.startB - j;
+            if(pos >= 0 && pos < offsetB - 1)
+                matched += gray_code_matches(fingerprintA + next.startA - j, fingerprintA + pos, 1);
+        }
+        return matched;
+    };
+    auto diagonal = [](const CommonSubArr& o) { return o.startB - o.startA; };
+
+    int size = matches.size();
+    StartIndex starts(matches);
+    unordered_map<int, set<int>> liveByDiagonal;
+    for(int i=0; i<size; i++)
+        liveByDiagonal[diagonal(matches[i])].insert(i);
+    vector<bool> removed(size, false);
+
+    vector<CommonSubArr> merged;
+    vector<int> candidates;
+    for(int i=size-1; i>=0; i--){
+        if(removed[i])
+            continue;
+        CommonSubArr next = matches[i];
+        while(true){
+            // A close match whose gap didn't look alike was skipped without stopping the search
+            int stop = starts.lastAtMost(i, next.startA - mergeThreshold);
+            while(stop >= 0 && abs(diagonal(matches[stop]) - diagonal(next)) <= offsetThreshold
+                && next.startA - matches[stop].startA - matches[stop].length <= mergeThreshold)
+                stop = starts.lastAtMost(stop, next.startA - mergeThreshold);
+            stop = std::max(stop, 0);
+            candidates.clear();
+            for(int d = diagonal(next) - offsetThreshold; d <= diagonal(next) + offsetThreshold; d++){
+                auto it = liveByDiagonal.find(d);
+                if(it == liveByDiagonal.end())
+                    continue;
+                for(auto pos = it->second.lower_bound(i); pos != it->second.begin() && *prev(pos) >= stop; pos--)
+                    candidates.push_back(*prev(pos));
+            }
+            sort(candidates.begin(), candidates.end(), greater<int>());
+            int taken = -1;
+            for(int k : candidates){
+                const CommonSubArr& cur = matches[k];
+                int gap = next.startA - cur.startA - cur.length;
+                if(gap<=mergeThreshold && (gap<=0 || gapMatches(next, gap) >= 0.75 * 16 * gap)){
+                    taken = k;
+                    break;
+                }
+            }
+            if(taken < 0)
+                break;
+            const CommonSubArr& cur = matches[taken];
+            next = (struct CommonSubArr){
+                cur.startA,
+                cur.startB,
+                std::min(next.startA + next.length - cur.startA, next.startB + next.length - cur.startB)
+            };
+            removed[taken] = true;
+            starts.remove(taken);
+            liveByDiagonal[diagonal(cur)].erase(taken);
+        }
+        merged.push_back(next);
+    }
+    reverse(merged.begin(), merged.end());
+    return merged;
+}
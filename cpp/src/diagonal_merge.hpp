@@ -0,0 +1,13 @@
+#ifndef DEFINED_DIAGONAL_MERGE_HPP
+#define DEFINED_DIAGONAL_MERGE_HPP
+#include <linear_longest_substring.hpp>
+#include <cstdint>
+#include <vector>
+
+// Joins matches within offsetThreshold diagonals of each other across gaps of at most mergeThreshold where 3/4 of the fields agree
+// matches are sorted by startA + startB, the result keeps that order. startB is an index in the concatenation
+// of A, a sentinel and B, fingerprintB starts at offsetB. Gives the same runs as the backwards erase loop it replaced
+std::vector<CommonSubArr> merge_diagonal_runs(const std::vector<CommonSubArr>& matches, const uint32_t* fingerprintA, const uint32_t* fingerprintB, int offsetB,
+    int mergeThreshold, int offsetThreshold);
+
+#endif
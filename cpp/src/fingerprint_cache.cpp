@@ -0,0 +1,190 @@
+#include "fingerprint_cache.hpp"
+#include <precision.h>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+Cache file layout, native byte order so an entry can be mapped and used without parsing
+    CacheHeader
+    uint32_t fingerprint[header.size]
+The magic doubles as a byte order check, entries from a machine with the other endianness never match
+Float and double builds of chromaprint may disagree on a few bits, each keeps its own entries
+*/
+constexpr uint32_t cacheMagic = 0x50464D49; // "IMFP"
+constexpr uint32_t cacheVersion = 2;
+constexpr int32_t cachePrecision = sizeof(chromaprint::Real) * 8;
+
+struct CacheHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t pcmHash;
+    int32_t algorithm;
+    int32_t sample_rate;
+    int32_t channels;
+    int32_t startShift;
+    int32_t endShift;
+    int32_t delay;
+    int32_t item_duration;
+    int32_t size;
+    // Bits in chromaprint::Real
+    int32_t precision;
+};
+static_assert(sizeof(CacheHeader) % alignof(uint32_t) == 0, "fingerprint must stay aligned after the header");
+
+// xxHash64 by Yann Collet, reads little endian words
+static const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t prime3 = 0x165667B19E3779F9ULL;
+static const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r){ return (x << r) | (x >> (64 - r)); }
+static inline uint64_t read64(const uint8_t* p){ uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint32_t read32(const uint8_t* p){ uint32_t v; memcpy(&v, p, 4); return v; }
+
+static inline uint64_t xxhRound(uint64_t acc, uint64_t input){
+    acc += input * prime2;
+    acc = rotl64(acc, 31);
+    return acc * prime1;
+}
+static inline uint64_t xxhMerge(uint64_t acc, uint64_t val){
+    acc ^= xxhRound(0, val);
+    return acc * prime1 + prime4;
+}
+
+static uint64_t xxhash64(const uint8_t* p, size_t len, uint64_t seed){
+    const uint8_t* end = p + len;
+    uint64_t h;
+    if(len >= 32){
+        uint64_t v1 = seed + prime1 + prime2, v2 = seed + prime2, v3 = seed, v4 = seed - prime1;
+        const uint8_t* limit = end - 32;
+        do{
+            v1 = xxhRound(v1, read64(p)); v2 = xxhRound(v2, read64(p + 8));
+            v3 = xxhRound(v3, read64(p + 16)); v4 = xxhRound(v4, read64(p + 24));
+            p += 32;
+        } while(p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxhMerge(h, v1); h = xxhMerge(h, v2); h = xxhMerge(h, v3); h = xxhMerge(h, v4);
+    }
+    else{
+        h = seed + prime5;
+    }
+    h += len;
+    for(; p + 8 <= end; p += 8){
+        h ^= xxhRound(0, read64(p));
+        h = rotl64(h, 27) * prime1 + prime4;
+    }
+    if(p + 4 <= end){
+        h ^= (uint64_t)read32(p) * prime1;
+        h = rotl64(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for(; p < end; p++){
+        h ^= *p * prime5;
+        h = rotl64(h, 11) * prime1;
+    }
+    h ^= h >> 33; h *= prime2;
+    h ^= h >> 29; h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t hashPCM(const int16_t* arr, int length){
+    return xxhash64((const uint8_t*)arr, (size_t)length * sizeof(int16_t), 0);
+}
+
+static std::string cachePath(const char* cacheDir, FingerprintKey key){
+    char name[128];
+    snprintf(name, sizeof(name), "/%016llx-%d-%d-%d-%d-%d-%d.fp", (unsigned long long)key.pcmHash,
+        key.algorithm, key.sample_rate, key.channels, key.startShift, key.endShift, cachePrecision);
+    return std::string(cacheDir) + name;
+}
+
+static bool headerMatches(const CacheHeader& header, FingerprintKey key){
+    return header.magic == cacheMagic && header.version == cacheVersion && header.precision == cachePrecision
+        && header.pcmHash == key.pcmHash && header.algorithm == key.algorithm
+        && header.sample_rate == key.sample_rate && header.channels == key.channels
+        && header.startShift == key.startShift && header.endShift == key.endShift;
+}
+
+bool loadCachedFingerprint(const char* cacheDir, FingerprintKey key, ChromaArr* chroma, int* delay, int* item_duration){
+#ifdef _WIN32
+    return false;
+#else
+    std::string path = cachePath(cacheDir, key);
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) || (size_t)st.st_size < sizeof(CacheHeader)){
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+
+    const CacheHeader* header = (const CacheHeader*)mapping;
+    if(!headerMatches(*header, key) || header->size < 0
+        || size != sizeof(CacheHeader) + (size_t)header->size * sizeof(uint32_t)){
+        munmap(mapping, size);
+        return false;
+    }
+    *delay = header->delay;
+    *item_duration = header->item_duration;
+    *chroma = (struct ChromaArr){
+        (uint32_t*)((uint8_t*)mapping + sizeof(CacheHeader)), header->size, false, mapping, size
+    };
+    return true;
+#endif
+}
+
+bool storeCachedFingerprint(const char* cacheDir, FingerprintKey key, ChromaArr chroma, int delay, int item_duration){
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = cacheMagic; header.version = cacheVersion; header.precision = cachePrecision;
+    header.pcmHash = key.pcmHash; header.algorithm = key.algorithm;
+    header.sample_rate = key.sample_rate; header.channels = key.channels;
+    header.startShift = key.startShift; header.endShift = key.endShift;
+    header.delay = delay; header.item_duration = item_duration;
+    header.size = chroma.size;
+
+    std::string path = cachePath(cacheDir, key);
+    // Unique per process and thread, other writers of the same entry never share it
+    std::string tmpPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#ifndef _WIN32
+    tmpPath += "." + std::to_string(getpid());
+#endif
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if(!file)
+        return false;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(chroma.arr, sizeof(uint32_t), chroma.size, file) == (size_t)chroma.size;
+    written = (fclose(file) == 0) && written;
+    if(!written || rename(tmpPath.c_str(), path.c_str())){
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void unmapCachedFingerprint(ChromaArr* chroma){
+#ifndef _WIN32
+    if(chroma->mapping)
+        munmap(chroma->mapping, chroma->mappingSize);
+#endif
+    chroma->mapping = nullptr;
+    chroma->mappingSize = 0;
+    chroma->arr = nullptr;
+}
@@ -0,0 +1,26 @@
+#ifndef DEFINED_FINGERPRINT_CACHE_HPP
+#define DEFINED_FINGERPRINT_CACHE_HPP
+#include <matcher.hpp>
+#include <cstdint>
+
+// Everything a raw fingerprint depends on
+struct FingerprintKey{
+    uint64_t pcmHash;
+    int algorithm;
+    int sample_rate;
+    int channels;
+    int startShift;
+    int endShift;
+};
+
+// 64 bit xxHash of the samples
+uint64_t hashPCM(const int16_t* arr, int length);
+
+// On a hit chroma points straight into a read-only mapping of the cache file
+// and delay/item_duration are the values the fingerprint was made with
+bool loadCachedFingerprint(const char* cacheDir, FingerprintKey key, ChromaArr* chroma, int* delay, int* item_duration);
+// Writes to a temporary file first so concurrent runs never see a partial entry
+bool storeCachedFingerprint(const char* cacheDir, FingerprintKey key, ChromaArr chroma, int delay, int item_duration);
+void unmapCachedFingerprint(ChromaArr* chroma);
+
+#endif
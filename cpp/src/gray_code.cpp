@@ -0,0 +1,164 @@
+#include "gray_code.hpp"
+#include <algorithm>
+#include <bit>
+#if defined(__x86_64__) || defined(__i386__)
+#define GRAY_CODE_X86
+#include <immintrin.h>
+#endif
+
+/*
+For each 32 bit word x = a ^ b, (x | x >> 1) & 0x55555555 leaves one bit per mismatching field
+The vector paths count those bits with the usual SWAR adds instead of a popcount instruction,
+the intermediate sums never carry across a field so this works 8 (AVX2) or 4 (SSE2) words at a time
+*/
+static inline int mismatches(uint32_t x){
+    return std::popcount((x | (x >> 1)) & 0x55555555u);
+}
+
+static int matchesScalar(const uint32_t* a, const uint32_t* b, int length){
+    int total = 0;
+    for(int i=0; i<length; i++)
+        total += mismatches(a[i] ^ b[i]);
+    return 16*length - total;
+}
+
+static void countsScalar(const uint32_t* a, const uint32_t* b, int length, uint8_t* out){
+    for(int i=0; i<length; i++)
+        out[i] = (uint8_t)(16 - mismatches(a[i] ^ b[i]));
+}
+
+#ifdef GRAY_CODE_X86
+__attribute__((target("sse2")))
+static inline __m128i mismatchesSSE2(__m128i a, __m128i b){
+    const __m128i fields = _mm_set1_epi32(0x55555555), pairs = _mm_set1_epi32(0x33333333), nibbles = _mm_set1_epi32(0x0F0F0F0F);
+    __m128i x = _mm_xor_si128(a, b);
+    x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi32(x, 1)), fields);
+    x = _mm_add_epi32(_mm_and_si128(x, pairs), _mm_and_si128(_mm_srli_epi32(x, 2), pairs));
+    x = _mm_and_si128(_mm_add_epi32(x, _mm_srli_epi32(x, 4)), nibbles);
+    x = _mm_add_epi32(x, _mm_srli_epi32(x, 8));
+    x = _mm_add_epi32(x, _mm_srli_epi32(x, 16));
+    return _mm_and_si128(x, _mm_set1_epi32(0x3F));
+}
+
+__attribute__((target("sse2")))
+static int matchesSSE2(const uint32_t* a, const uint32_t* b, int length){
+    __m128i sum = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+        sum = _mm_add_epi32(sum, mismatchesSSE2(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i))));
+    alignas(16) int lanes[4];
+    _mm_store_si128((__m128i*)lanes, sum);
+    int total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return 16*i - total + matchesScalar(a + i, b + i, length - i);
+}
+
+__attribute__((target("sse2")))
+static void countsSSE2(const uint32_t* a, const uint32_t* b, int length, uint8_t* out){
+    const __m128i full = _mm_set1_epi32(16);
+    int i = 0;
+    for(; i + 4 <= length; i += 4){
+        __m128i counts = _mm_sub_epi32(full, mismatchesSSE2(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i))));
+        alignas(16) int lanes[4];
+        _mm_store_si128((__m128i*)lanes, counts);
+        for(int k=0; k<4; k++)
+            out[i+k] = (uint8_t)lanes[k];
+    }
+    countsScalar(a + i, b + i, length - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mismatchesAVX2(__m256i a, __m256i b){
+    const __m256i fields = _mm256_set1_epi32(0x55555555), pairs = _mm256_set1_epi32(0x33333333), nibbles = _mm256_set1_epi32(0x0F0F0F0F);
+    __m256i x = _mm256_xor_si256(a, b);
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi32(x, 1)), fields);
+    x = _mm256_add_epi32(_mm256_and_si256(x, pairs), _mm256_and_si256(_mm256_srli_epi32(x, 2), pairs));
+    x = _mm256_and_si256(_mm256_add_epi32(x, _mm256_srli_epi32(x, 4)), nibbles);
+    x = _mm256_add_epi32(x, _mm256_srli_epi32(x, 8));
+    x = _mm256_add_epi32(x, _mm256_srli_epi32(x, 16));
+    return _mm256_and_si256(x, _mm256_set1_epi32(0x3F));
+}
+
+__attribute__((target("avx2")))
+static int matchesAVX2(const uint32_t* a, const uint32_t* b, int length){
+    __m256i sum0 = _mm256_setzero_si256(), sum1 = _mm256_setzero_si256();
+    int i = 0;
+    // Two independent accumulators, 16 words per iteration
+    for(; i + 16 <= length; i += 16){
+        sum0 = _mm256_add_epi32(sum0, mismatchesAVX2(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i))));
+        sum1 = _mm256_add_epi32(sum1, mismatchesAVX2(_mm256_loadu_si256((const __m256i*)(a + i + 8)), _mm256_loadu_si256((const __m256i*)(b + i + 8))));
+    }
+    for(; i + 8 <= length; i += 8)
+        sum0 = _mm256_add_epi32(sum0, mismatchesAVX2(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i))));
+    alignas(32) int lanes[8];
+    _mm256_store_si256((__m256i*)lanes, _mm256_add_epi32(sum0, sum1));
+    int total = 0;
+    for(int k=0; k<8; k++)
+        total += lanes[k];
+    return 16*i - total + matchesScalar(a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static void countsAVX2(const uint32_t* a, const uint32_t* b, int length, uint8_t* out){
+    const __m256i full = _mm256_set1_epi32(16);
+    // Every count fits a byte, pack 32 of them per store
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i = 0;
+    for(; i + 32 <= length; i += 32){
+        __m256i c[4];
+        for(int k=0; k<4; k++)
+            c[k] = _mm256_sub_epi32(full, mismatchesAVX2(_mm256_loadu_si256((const __m256i*)(a + i + 8*k)), _mm256_loadu_si256((const __m256i*)(b + i + 8*k))));
+        __m256i words = _mm256_packs_epi32(c[0], c[1]);
+        __m256i words2 = _mm256_packs_epi32(c[2], c[3]);
+        __m256i bytes = _mm256_packus_epi16(words, words2);
+        // The packs work per 128 bit lane, put the 4 byte groups back in order
+        bytes = _mm256_permutevar8x32_epi32(bytes, order);
+        _mm256_storeu_si256((__m256i*)(out + i), bytes);
+    }
+    countsScalar(a + i, b + i, length - i, out + i);
+}
+#endif
+
+std::vector<GrayCodeKernels> gray_code_kernels(){
+    std::vector<GrayCodeKernels> supported = {(struct GrayCodeKernels){"scalar", matchesScalar, countsScalar}};
+#ifdef GRAY_CODE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2"))
+        supported.push_back((struct GrayCodeKernels){"sse2", matchesSSE2, countsSSE2});
+    if(__builtin_cpu_supports("avx2"))
+        supported.push_back((struct GrayCodeKernels){"avx2", matchesAVX2, countsAVX2});
+#endif
+    return supported;
+}
+
+static const GrayCodeKernels kernels = gray_code_kernels().back();
+
+int gray_code_matches(const uint32_t* a, const uint32_t* b, int length){
+    if(length <= 0)
+        return 0;
+    return kernels.matches(a, b, length);
+}
+
+std::vector<double> gray_code_similarity(std::span<const uint32_t> a, std::span<const uint32_t> b, int window, int step){
+    int length = (int)std::min(a.size(), b.size());
+    std::vector<double> curve;
+    if(window <= 0 || step <= 0 || length < window)
+        return curve;
+    std::vector<uint8_t> counts(length);
+    kernels.counts(a.data(), b.data(), length, counts.data());
+    curve.reserve((length - window) / step + 1);
+    // Running sum over the window, windows that don't overlap are summed from scratch
+    int sum = 0;
+    int sumStart = 0, sumEnd = 0;
+    for(int start = 0; start + window <= length; start += step){
+        if(start >= sumEnd){
+            sum = 0;
+            sumStart = sumEnd = start;
+        }
+        for(; sumStart < start; sumStart++)
+            sum -= counts[sumStart];
+        for(; sumEnd < start + window; sumEnd++)
+            sum += counts[sumEnd];
+        curve.push_back(sum / (16.0 * window));
+    }
+    return curve;
+}
@@ -0,0 +1,28 @@
+#ifndef DEFINED_GRAY_CODE_HPP
+#define DEFINED_GRAY_CODE_HPP
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Chromaprint sub fingerprints are 16 gray coded 2 bit fields, two fields match when neither bit differs
+// Uses AVX2 or SSE2 when the cpu has them, picked once at runtime
+
+// Number of agreeing fields over a[0, length) and b[0, length), out of 16*length
+int gray_code_matches(const uint32_t* a, const uint32_t* b, int length);
+
+// Similarity curve of a and b compared index by index
+// Entry w is the share of agreeing fields in [w*step, w*step + window), the curve stops at the last full window
+std::vector<double> gray_code_similarity(std::span<const uint32_t> a, std::span<const uint32_t> b, int window, int step = 1);
+
+struct GrayCodeKernels{
+    const char* name;
+    // Agreeing fields over the whole range
+    int (*matches)(const uint32_t*, const uint32_t*, int);
+    // Agreeing fields per word, out[i] for a[i] and b[i]
+    void (*counts)(const uint32_t*, const uint32_t*, int, uint8_t*);
+};
+
+// Every kernel this cpu can run, scalar first and the fastest last, the functions above use the last one
+std::vector<GrayCodeKernels> gray_code_kernels();
+
+#endif
@@ -1,32 +1,54 @@
 #include "linear_longest_substring.hpp"
-#include <vector>
 #include <algorithm>
+#include <climits>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
-int* create_rank_arr(int *suffixArr, int size){
-    int* rank = new int[size];
-    for(int i=0; i<size; i++){
-        rank[suffixArr[i]] = i;
+int* create_plcp_arr(int *suffixArr, int* arr, int size, int* buffer){
+    int* plcp = buffer ? buffer : new int[size];
+    if(size == 0)
+        return plcp;
+    // phi[p] is the suffix just before p in suffixArr
+    plcp[suffixArr[0]] = -1;
+    for(int i=1; i<size; i++){
+        plcp[suffixArr[i]] = suffixArr[i-1];
     }
-    return rank;
-}
-
-int* create_lcp_arr(int *suffixArr, int* rankArr, int* arr, int size){
-    int* lcp = new int[size]; lcp[0] = 0;
-    int count=0;
+    // Going through the suffixes in text order the lcp drops by at most 1 per step,
+    // and plcp[i] overwrites phi[i] right after it's read
+    int count = 0;
     for(int i=0; i < size; i++){
-        if(rankArr[i] > 0){
-            int j = suffixArr[rankArr[i]-1];
-            while(arr[i+count] == arr[j+count])
-                count++; 
-            lcp[rankArr[i]] = count;
-            if(count>0) 
-               count--;
+        int j = plcp[i];
+        if(j < 0){
+            plcp[i] = count = 0;
+            continue;
         }
+        while(arr[i+count] == arr[j+count])
+            count++;
+        plcp[i] = count;
+        if(count>0)
+            count--;
     }
+    return plcp;
+}
 
-    return lcp;
+void plcp_to_lcp(int *suffixArr, int* plcp, int size, int* out){
+    for(int i=0; i<size; i++){
+        out[i] = plcp[suffixArr[i]];
+    }
+}
+
+vector<LcpEntry> sparse_lcp(int *suffixArr, int* plcp, int size, int threshold){
+    vector<LcpEntry> entries;
+    for(int i=1; i<size; i++){
+        int length = plcp[suffixArr[i]];
+        if(length > threshold)
+            entries.push_back((struct LcpEntry){i, length});
+    }
+    return entries;
 }
 
 bool intersect(CommonSubArr a, CommonSubArr b){
@@ -39,41 +61,271 @@ bool compareByStart(const CommonSubArr &a, const CommonSubArr &b){
     return a.startA + a.startB < b.startA + b.startB;
 }
 
-vector<CommonSubArr> longest_common_substring(int *suffixArr, int* lcpArr, int size, int sizeA, int threshold){
+/*
+Closed intervals [start, end] tagged with the slot of the result that owns them. A match replaced by a longer one
+can overlap the others stored with it, so the intervals aren't disjoint.
+An interval meets [from, to] when it contains from or starts in (from, to], a segment tree over positions answers both
+
+    covering    every interval is kept at the nodes that exactly cover it, so the nodes on the path
+                from a leaf to the root hold every interval containing that position
+    minStart    every leaf holds the smallest slot starting there and inner nodes the smallest below them
+
+Inserting, erasing and querying visit O(log n) nodes however long the stored intervals are
+*/
+class IntervalIndex{
+public:
+    // Positions go from 0 to extent - 1
+    explicit IntervalIndex(int extent){
+        while(leaves < extent)
+            leaves *= 2;
+        minStart.assign(2*leaves, INT_MAX);
+    }
+
+    void insert(int start, int end, int slot){
+        forCover(start, end, [&](int node){ covering[node].insert(slot); });
+        startsAt[start].insert(slot);
+        updateStart(start);
+    }
+
+    void erase(int start, int end, int slot){
+        forCover(start, end, [&](int node){ eraseSlot(covering, node, slot); });
+        eraseSlot(startsAt, start, slot);
+        updateStart(start);
+    }
+
+    // Smallest slot whose interval intersects [from, to], or best if that is smaller
+    int firstIntersecting(int from, int to, int best) const{
+        for(int node = from + leaves; node > 0; node >>= 1){
+            auto it = covering.find(node);
+            if(it != covering.end())
+                best = std::min(best, *it->second.begin());
+        }
+        for(int l = from + 1 + leaves, r = to + 1 + leaves; l < r; l >>= 1, r >>= 1){
+            if(l & 1)
+                best = std::min(best, minStart[l++]);
+            if(r & 1)
+                best = std::min(best, minStart[--r]);
+        }
+        return best;
+    }
+
+private:
+    template<typename Visit>
+    void forCover(int start, int end, Visit visit) const{
+        for(int l = start + leaves, r = end + 1 + leaves; l < r; l >>= 1, r >>= 1){
+            if(l & 1)
+                visit(l++);
+            if(r & 1)
+                visit(--r);
+        }
+    }
+
+    static void eraseSlot(unordered_map<int, set<int>>& slots, int key, int slot){
+        auto it = slots.find(key);
+        it->second.erase(slot);
+        if(it->second.empty())
+            slots.erase(it);
+    }
+
+    void updateStart(int start){
+        auto it = startsAt.find(start);
+        int node = start + leaves;
+        minStart[node] = it == startsAt.end() ? INT_MAX : *it->second.begin();
+        for(node >>= 1; node > 0; node >>= 1)
+            minStart[node] = std::min(minStart[2*node], minStart[2*node+1]);
+    }
+
+    int leaves = 1;
+    vector<int> minStart;
+    // Only nodes and starts holding an interval have an entry
+    unordered_map<int, set<int>> covering;
+    unordered_map<int, set<int>> startsAt;
+};
+
+// forEachEntry(visit) calls visit with every lcp entry to look at in increasing index, so dense and sparse lcp arrays share the walk
+template<typename ForEachEntry>
+static vector<CommonSubArr> findCommonSubstrings(int *suffixArr, int sizeA, ForEachEntry forEachEntry){
+    // Every match ends before the sentinel in A or the end of the array in B
+    int extent = sizeA + 1;
+    forEachEntry([&](const LcpEntry& entry){
+        extent = std::max({extent, suffixArr[entry.index] + entry.length + 1, suffixArr[entry.index-1] + entry.length + 1});
+    });
+
     vector<CommonSubArr> substrings;
-    
-    for(int i=1; i<size; i++){
-        if(lcpArr[i]>threshold){
-            int a = suffixArr[i];
-            int b = suffixArr[i-1];
-            CommonSubArr cur = (struct CommonSubArr){0, 0, 0};
-            if((a<sizeA && b>sizeA)){
-                cur.startA = a; cur.startB = b;
-                cur.length = lcpArr[i];
+    // Overlap in either file counts, the earliest overlapping match is the one that gets replaced
+    IntervalIndex indexA(extent), indexB(extent);
+
+    forEachEntry([&](const LcpEntry& entry){
+        int a = suffixArr[entry.index];
+        int b = suffixArr[entry.index-1];
+        CommonSubArr cur = (struct CommonSubArr){0, 0, 0};
+        if((a<sizeA && b>sizeA)){
+            cur.startA = a; cur.startB = b;
+            cur.length = entry.length;
+        }
+        else if((b<sizeA && a>sizeA)){
+            cur.startA = b; cur.startB = a;
+            cur.length = entry.length;
+        }
+        if(cur.startA + cur.startB + cur.length > 0){
+            int none = substrings.size();
+            int slot = indexA.firstIntersecting(cur.startA, cur.startA + cur.length, none);
+            slot = indexB.firstIntersecting(cur.startB, cur.startB + cur.length, slot);
+            if(slot == none){
+                substrings.push_back(cur);
+                indexA.insert(cur.startA, cur.startA + cur.length, slot);
+                indexB.insert(cur.startB, cur.startB + cur.length, slot);
             }
-            else if((b<sizeA && a>sizeA)){
-                cur.startA = b; cur.startB = a;
-                cur.length = lcpArr[i];
+            else if(substrings[slot].length < cur.length){
+                const CommonSubArr& old = substrings[slot];
+                indexA.erase(old.startA, old.startA + old.length, slot);
+                indexB.erase(old.startB, old.startB + old.length, slot);
+                substrings[slot] = cur;
+                indexA.insert(cur.startA, cur.startA + cur.length, slot);
+                indexB.insert(cur.startB, cur.startB + cur.length, slot);
             }
-            if(cur.startA + cur.startB + cur.length > 0){
-                bool assigned = false;
-                for(int j=0; j<substrings.size(); j++){
-                    if(intersect(cur, substrings[j])){
-                        if(substrings[j].length < cur.length)
-                            substrings[j] = cur;
-                        assigned = true;
-                        break;
+        }
+    });
+    sort(substrings.begin(), substrings.end(), compareByStart);
+    return substrings;
+}
+
+vector<CommonSubArr> longest_common_substring(int *suffixArr, int* lcpArr, int size, int sizeA, int threshold){
+    return findCommonSubstrings(suffixArr, sizeA, [&](auto visit){
+        for(int i=1; i<size; i++){
+            if(lcpArr[i]>threshold)
+                visit((struct LcpEntry){i, lcpArr[i]});
+        }
+    });
+}
+
+vector<CommonSubArr> longest_common_substring(int *suffixArr, const vector<LcpEntry>& lcpEntries, int sizeA){
+    return findCommonSubstrings(suffixArr, sizeA, [&](auto visit){
+        for(const LcpEntry& entry : lcpEntries)
+            visit(entry);
+    });
+}
+
+vector<DiagonalGroup> group_by_diagonal(const vector<CommonSubArr>& substrings){
+    vector<CommonSubArr> sorted = substrings;
+    sort(sorted.begin(), sorted.end(), [](const CommonSubArr& a, const CommonSubArr& b){
+        int diagA = a.startB - a.startA, diagB = b.startB - b.startA;
+        return diagA != diagB ? diagA < diagB : a.startA < b.startA;
+    });
+    vector<DiagonalGroup> groups;
+    for(const CommonSubArr& cur : sorted){
+        int diagonal = cur.startB - cur.startA;
+        if(groups.empty() || groups.back().diagonal != diagonal)
+            groups.push_back((struct DiagonalGroup){diagonal, {}});
+        groups.back().matches.push_back(cur);
+    }
+    return groups;
+}
+
+
+
+// Kept sub arrays never overlap in a file they share, so in every file they are disjoint
+// and only the last one starting before an interval's end can overlap it
+class DisjointIntervals{
+    std::map<int,int> endByStart;
+public:
+    bool overlaps(int start, int end) const{
+        auto it = endByStart.lower_bound(end);
+        return it != endByStart.begin() && prev(it)->second > start;
+    }
+    void insert(int start, int end){
+        endByStart[start] = end;
+    }
+};
+
+vector<SharedSubArr> shared_substrings(int *suffixArr, int* lcpArr, int size, const vector<int>& fileStarts, int minSupport, int threshold){
+    int files = fileStarts.size()-1;
+    auto fileOf = [&fileStarts](int pos) {
+        return (int)(upper_bound(fileStarts.begin(), fileStarts.end(), pos) - fileStarts.begin()) - 1;
+    };
+
+    // Bottom up walk over the lcp intervals, each open interval remembers the first occurrence in every file
+    // firstPos holds files entries per stack level so nothing is allocated per interval
+    vector<int> lcpStack = {0};
+    vector<int> supportStack = {0};
+    vector<int> firstPos(files, -1);
+    vector<int> popped(files);
+    vector<SharedSubArr> candidates;
+
+    auto addOccurrence = [&](int level, int pos) {
+        int f = fileOf(pos);
+        int& slot = firstPos[level*files + f];
+        if(slot < 0){
+            slot = pos - fileStarts[f];
+            supportStack[level]++;
+        }
+    };
+
+    for(int i=1; i<=size; i++){
+        // Suffixes past the end close every interval
+        int lcp = i<size ? lcpArr[i] : 0;
+        addOccurrence(lcpStack.size()-1, suffixArr[i-1]);
+        bool hasPopped = false;
+        int poppedSupport = 0;
+        while(lcp < lcpStack.back()){
+            int level = lcpStack.size()-1;
+            int length = lcpStack.back();
+            int support = supportStack.back();
+            std::copy(firstPos.begin() + level*files, firstPos.begin() + (level+1)*files, popped.begin());
+            if(length > threshold && support >= minSupport){
+                candidates.push_back((struct SharedSubArr){length, support, popped});
+            }
+            lcpStack.pop_back(); supportStack.pop_back();
+            firstPos.resize(level*files);
+            hasPopped = true;
+            poppedSupport = support;
+            // The popped interval is a child of the new top unless a new interval goes in between
+            if(lcp <= lcpStack.back()){
+                int parent = lcpStack.size()-1;
+                for(int f=0; f<files; f++){
+                    int& slot = firstPos[parent*files + f];
+                    if(slot < 0 && popped[f] >= 0){
+                        slot = popped[f];
+                        supportStack[parent]++;
                     }
                 }
-                if(!assigned){
-                    substrings.push_back(cur);
-                }
+                hasPopped = false;
+            }
+        }
+        if(lcp > lcpStack.back()){
+            lcpStack.push_back(lcp);
+            if(hasPopped){
+                supportStack.push_back(poppedSupport);
+                firstPos.insert(firstPos.end(), popped.begin(), popped.end());
             }
+            else{
+                supportStack.push_back(0);
+                firstPos.resize(firstPos.size() + files, -1);
+                // The new interval starts at the previous suffix, which so far only went to its parent
+                addOccurrence(lcpStack.size()-1, suffixArr[i-1]);
+            }
+        }
+    }
 
+    // Every shifted copy of a match is also an interval, keep only the longest and best supported
+    sort(candidates.begin(), candidates.end(), [](const SharedSubArr &a, const SharedSubArr &b) {
+        return a.length != b.length ? a.length > b.length : a.support > b.support;
+    });
+    vector<SharedSubArr> shared;
+    vector<DisjointIntervals> kept(files);
+    for(SharedSubArr& cur : candidates){
+        bool assigned = false;
+        for(int f=0; f<files && !assigned; f++){
+            if(cur.starts[f] >= 0)
+                assigned = kept[f].overlaps(cur.starts[f], cur.starts[f] + cur.length);
+        }
+        if(!assigned){
+            for(int f=0; f<files; f++){
+                if(cur.starts[f] >= 0)
+                    kept[f].insert(cur.starts[f], cur.starts[f] + cur.length);
+            }
+            shared.push_back(cur);
         }
     }
-    sort(substrings.begin(), substrings.end(), compareByStart);
-    return substrings;
+    return shared;
 }
-
-
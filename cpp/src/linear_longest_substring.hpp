@@ -8,14 +8,44 @@ struct CommonSubArr{
     int length;
 };
 
-// suffixArr must be a valid suffix array with values in the range [0, size-1]
-int* create_rank_arr(int *suffixArr, int size);
+// Permuted lcp by the phi method, plcp[p] is the lcp of the suffix at p and the one before it in suffixArr
+// Needs no rank array, so only suffixArr, arr and the result are alive at once
+// The result is written to buffer when given (any size int array that is no longer needed), otherwise allocated
+int* create_plcp_arr(int *suffixArr, int* arr, int size, int* buffer = nullptr);
 
-// suffixArr must be a valid suffix array with values in the range [0, size-1]
-// similiarly rankArr must be the inverse of suffixArr from the function above
-int* create_lcp_arr(int *suffixArr, int* rankArr, int* arr, int size);
+// lcp[i] = plcp[suffixArr[i]], out may be suffixArr or arr to reuse their memory
+void plcp_to_lcp(int *suffixArr, int* plcp, int size, int* out);
 
+struct LcpEntry{
+    int index;
+    int length;
+};
+
+// Only the suffix array positions whose lcp is above threshold, in increasing order
+std::vector<LcpEntry> sparse_lcp(int *suffixArr, int* plcp, int size, int threshold);
 
 std::vector<CommonSubArr> longest_common_substring(int *suffixArr, int* lcpArr, int size, int sizeA, int threshold);
+// Matches overlapping an earlier one in either file replace it if they're longer, otherwise they're dropped
+std::vector<CommonSubArr> longest_common_substring(int *suffixArr, const std::vector<LcpEntry>& lcpEntries, int sizeA);
+
+// Matches with the same startB - startA, sorted by diagonal and then by startA
+struct DiagonalGroup{
+    int diagonal;
+    std::vector<CommonSubArr> matches;
+};
+std::vector<DiagonalGroup> group_by_diagonal(const std::vector<CommonSubArr>& substrings);
+
+struct SharedSubArr{
+    int length;
+    // Number of files the sub array appears in
+    int support;
+    // Start in each file's own array, -1 for files that don't contain it
+    std::vector<int> starts;
+};
+
+// Works on a generalized suffix array of several files concatenated with a distinct sentinel after each one
+// fileStarts[f] is the index file f starts at in the concatenation, with fileStarts.back() == size
+// Returns the longest sub arrays found in at least minSupport files, overlapping matches keep only the longest
+std::vector<SharedSubArr> shared_substrings(int *suffixArr, int* lcpArr, int size, const std::vector<int>& fileStarts, int minSupport, int threshold);
 
 #endif
@@ -0,0 +1,351 @@
+#include "matcher.hpp"
+#include <chromaprint.h>
+#include <diagonal_merge.hpp>
+#include <fingerprint_cache.hpp>
+#include <gray_code.hpp>
+#include <suffix_array.hpp>
+#include <linear_longest_substring.hpp>
+#include <iostream>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+using std::cout; using std::endl; using std::sort; using std::tuple; using std::vector;
+
+void freeChromaArr(ChromaArr* input){
+    if(!input->deleted){
+        if(input->mapping){
+            unmapCachedFingerprint(input);
+        }
+        else{
+            // Raw fingerprints are allocated by chromaprint
+            chromaprint_dealloc(input->arr);
+        }
+        input->deleted = true;
+    }
+}
+
+/*
+Rank compression without a tree
+Each element becomes the 64 bit key value<<32 | index, an LSD radix sort on the value bytes
+orders them and a single pass over the sorted keys hands out ranks
+Byte passes where every value has the same byte are skipped, chroma values rarely use all 4
+*/
+tuple<int*, uint32_t*, int> compress(uint32_t* arr, int size, int firstRank){
+    uint64_t* keys = new uint64_t[size];
+    uint64_t* buffer = new uint64_t[size];
+    int counts[4][256] = {};
+    for(int i = 0; i < size; i++){
+        keys[i] = ((uint64_t)arr[i] << 32) | (uint32_t)i;
+        for(int b = 0; b < 4; b++)
+            counts[b][(arr[i] >> (8*b)) & 255]++;
+    }
+    for(int b = 0; b < 4; b++){
+        if(size == 0 || counts[b][(arr[0] >> (8*b)) & 255] == size)
+            continue;
+        int offsets[256];
+        for(int d = 0, sum = 0; d < 256; d++){
+            offsets[d] = sum;
+            sum += counts[b][d];
+        }
+        int shift = 32 + 8*b;
+        for(int i = 0; i < size; i++)
+            buffer[offsets[(keys[i] >> shift) & 255]++] = keys[i];
+        std::swap(keys, buffer);
+    }
+    delete[] buffer;
+    delete[] arr;
+
+    int* res = new int[size+3];
+    res[size] = res[size+1] = res[size+2] = 0;
+    // Ranks below firstRank are reserved for sentinels
+    int rank = firstRank;
+    int distinct = 0;
+    for(int i = 0; i < size; i++){
+        if(i == 0 || (keys[i] >> 32) != (keys[i-1] >> 32))
+            distinct++;
+    }
+    uint32_t* rank_to_val = new uint32_t[firstRank + distinct];
+    for(int i = 0; i < size; i++){
+        uint32_t val = (uint32_t)(keys[i] >> 32);
+        if(i > 0 && val != (uint32_t)(keys[i-1] >> 32))
+            rank++;
+        rank_to_val[rank] = val;
+        res[(uint32_t)keys[i]] = rank;
+    }
+    delete[] keys;
+    return std::make_tuple(res, rank_to_val, firstRank + distinct);
+}
+
+// A 2 bit field matches when neither of its bits differ, so OR each field's high bit into its low bit
+// and count the low bits that are left set
+static inline int gray_code_mismatches(uint32_t c){
+    return std::popcount((c | (c >> 1)) & 0x55555555u);
+}
+
+double compare_gray_codes(uint32_t a, uint32_t b){
+    return (16 - gray_code_mismatches(a ^ b)) / 16.0;
+}
+
+// How far t is from gap, 0 inside it
+static double distanceToGap(double t, TimeRange gap){
+    return std::max({gap.start - t, t - gap.end, 0.0});
+}
+
+TimeRange snapToSilence(TimeRange range, const vector<TimeRange>& silence, double tolerance){
+    TimeRange snapped = range;
+    double startDistance = tolerance; double endDistance = tolerance;
+    for(TimeRange gap : silence){
+        if(distanceToGap(range.start, gap) <= startDistance){
+            startDistance = distanceToGap(range.start, gap);
+            snapped.start = gap.start;
+        }
+        if(distanceToGap(range.end, gap) <= endDistance){
+            endDistance = distanceToGap(range.end, gap);
+            snapped.end = gap.end;
+        }
+    }
+    return snapped.end > snapped.start ? snapped : range;
+}
+
+void matchPair(ChromaArr chromaA, ChromaArr chromaB, PairInfo info, vector<TimeRange> outputRanges[2], bool verbose){
+    int sample_rate = info.sample_rate;
+    int delay = info.delay; int item_duration = info.item_duration;
+    double startShiftsec = (double) info.startShift/sample_rate; double endShiftsec = (double) info.endShift/sample_rate;
+
+    int combinedLen = chromaA.size + chromaB.size + 1;
+    int offset = chromaA.size + 1;
+    uint32_t * merged = new uint32_t[combinedLen];
+    std::copy(chromaA.arr, chromaA.arr + chromaA.size, merged);
+    std::copy(chromaB.arr, chromaB.arr + chromaB.size, merged + offset);
+
+    int max; int* compressed; uint32_t* rank_to_val;
+    std::tie(compressed, rank_to_val, max) = compress(merged, combinedLen);
+
+    // Sentinel in between the 2 strings
+    compressed[chromaA.size] = 0;
+    if(verbose) cout << "Finished compressing\n";
+    int* suffixArr = suffix_array(compressed, combinedLen, max);
+    if(verbose) cout << "Made suffix array of length " << combinedLen << endl;
+    delete[] rank_to_val;
+    int* plcpArr = create_plcp_arr(suffixArr, compressed, combinedLen);
+    // The text isn't needed past this point, its buffer takes the lcp array
+    int* lcpArr = compressed;
+    plcp_to_lcp(suffixArr, plcpArr, combinedLen, lcpArr);
+    delete[] plcpArr;
+    if(verbose) cout << "Made LCP array\n";
+
+    auto toSec = [item_duration, sample_rate](int in) {
+        return (double) in * item_duration / sample_rate;
+    };
+
+    // Every nonzero lcp is a candidate, short matches can still be joined into long ones below
+    int threshold = 0;
+    vector<CommonSubArr> common_substring_list = longest_common_substring(suffixArr, lcpArr, combinedLen, chromaA.size, threshold);
+    delete[] suffixArr;
+    delete[] lcpArr;
+    if(verbose) cout << "Common substrings " << common_substring_list.size() << endl;
+    
+    int delay_item = delay/item_duration;
+    int mergeThreshold = 5*delay_item;
+    int offsetThreshold = std::max(2, (int)(0.25 * sample_rate / item_duration));
+    
+    // Pad past the last match so the merge below can extend it while the fingerprints stay similar
+    if(common_substring_list.size()>0)
+    for(int i=0;i<125;i++){
+        CommonSubArr pad = (struct CommonSubArr){
+            common_substring_list.back().startA + delay_item/30,
+            common_substring_list.back().startB + delay_item/30,
+            0
+        };
+        if(pad.startA >= chromaA.size || pad.startB >= combinedLen)
+            break;
+        common_substring_list.push_back(pad);
+    }
+
+    common_substring_list = merge_diagonal_runs(common_substring_list, chromaA.arr, chromaB.arr, offset, mergeThreshold, offsetThreshold);
+    common_substring_list.erase(
+    std::remove_if(common_substring_list.begin(), common_substring_list.end(),
+        [delay_item](const CommonSubArr & o) { return o.length <= delay_item; }),
+    common_substring_list.end());
+
+    if(verbose) cout << "Merged substrings " << common_substring_list.size() << endl; 
+
+    double delay_sec = (double)delay/sample_rate;
+    for(int i=0;i<2;i++)
+        if(info.fromStart || startShiftsec > 0)
+            outputRanges[i].push_back((struct TimeRange){0, startShiftsec}); 
+
+    for(CommonSubArr common: common_substring_list){
+        TimeRange curA = (struct TimeRange){
+            startShiftsec + toSec(common.startA),
+            startShiftsec + toSec(common.startA + common.length) + delay_sec * 1
+        };
+        outputRanges[0].push_back(curA);
+
+        TimeRange curB = (struct TimeRange){
+            startShiftsec + toSec(common.startB - offset),
+            startShiftsec + toSec(common.startB - offset + common.length) + delay_sec * 1
+        };
+        outputRanges[1].push_back(curB);
+    }
+
+    double secondMergeThreshold = delay_sec;
+    double lengthSec[2] = {info.lengthSecA, info.lengthSecB};
+    for(int i=0;i<2;i++){
+        if(info.toEnd || endShiftsec > 0)
+            outputRanges[i].push_back((struct TimeRange){lengthSec[i] - endShiftsec, lengthSec[i]});
+        sort(outputRanges[i].begin(), outputRanges[i].end(), sortByStart);
+        for(int k=outputRanges[i].size()-1; k>0; k--){
+            TimeRange cur = outputRanges[i][k-1]; TimeRange next = outputRanges[i][k];
+            if(next.start - cur.end <= secondMergeThreshold){
+                outputRanges[i][k-1].end = next.end;
+                outputRanges[i].erase(outputRanges[i].begin()+k);
+            }
+
+        }
+    }
+}
+
+vector<SeasonSegment> matchSeason(vector<ChromaArr> chromas, int minSupport, int sample_rate, int delay, int item_duration, bool verbose){
+    int files = chromas.size();
+    // Every file is followed by its own sentinel
+    vector<int> fileStarts(files+1, 0);
+    for(int f=0; f<files; f++){
+        fileStarts[f+1] = fileStarts[f] + chromas[f].size + 1;
+    }
+    int combinedLen = fileStarts[files];
+    uint32_t * merged = new uint32_t[combinedLen];
+    for(int f=0; f<files; f++){
+        std::copy(chromas[f].arr, chromas[f].arr + chromas[f].size, merged + fileStarts[f]);
+        merged[fileStarts[f+1]-1] = 0;
+    }
+
+    int max; int* compressed; uint32_t* rank_to_val;
+    // Ranks 1 to files are the sentinels, all distinct so no match can run from one file into the next
+    std::tie(compressed, rank_to_val, max) = compress(merged, combinedLen, files+1);
+    for(int f=0; f<files; f++){
+        compressed[fileStarts[f+1]-1] = f+1;
+    }
+    delete[] rank_to_val;
+    if(verbose) cout << "Finished compressing\n";
+    int* suffixArr = suffix_array(compressed, combinedLen, max);
+    if(verbose) cout << "Made suffix array of length " << combinedLen << endl;
+    int* plcpArr = create_plcp_arr(suffixArr, compressed, combinedLen);
+    // The text isn't needed past this point, its buffer takes the lcp array
+    int* lcpArr = compressed;
+    plcp_to_lcp(suffixArr, plcpArr, combinedLen, lcpArr);
+    delete[] plcpArr;
+    if(verbose) cout << "Made LCP array\n";
+
+    int delay_item = delay/item_duration;
+    int mergeThreshold = 5*delay_item;
+    int offsetThreshold = std::max(2, (int)(0.25 * sample_rate / item_duration));
+
+    // Exact runs shorter than the offset tolerance are mostly chance collisions
+    vector<SharedSubArr> shared = shared_substrings(suffixArr, lcpArr, combinedLen, fileStarts, minSupport, offsetThreshold);
+    delete[] suffixArr;
+    delete[] lcpArr;
+    if(verbose) cout << "Shared substrings " << shared.size() << endl;
+
+    auto firstFile = [files](const SharedSubArr &o) {
+        for(int f=0; f<files; f++)
+            if(o.starts[f]>=0) return f;
+        return -1;
+    };
+    // Looks alike when the fingerprints agree along the diagonal from every shared file to the reference file
+    // Files the merged run can't start in are left out of it, so their gap isn't looked at
+    auto gapMatches = [&](const SharedSubArr &next, int ref, int gap, int shift) {
+        for(int f=0; f<files; f++){
+            if(f==ref || next.starts[f]<0 || next.starts[f] - shift < 0)
+                continue;
+            int matched = gray_code_matches(chromas[ref].arr + next.starts[ref] - gap, chromas[f].arr + next.starts[f] - gap, gap);
+            if(matched < 0.75 * 16 * gap)
+                return false;
+        }
+        return true;
+    };
+
+    /*
+    Same idea as the pair merge, runs that sit on the same diagonals are joined across gaps that still look alike.
+    Runs are grouped by the first file they appear in and positions are compared in that file,
+    files missing from one of the two runs take their position from the diagonal of the other.
+    */
+    auto mergeRuns = [&](vector<SharedSubArr> runs) {
+        sort(runs.begin(), runs.end(), [&](const SharedSubArr &a, const SharedSubArr &b) {
+            int fa = firstFile(a); int fb = firstFile(b);
+            return fa != fb ? fa < fb : a.starts[fa] < b.starts[fb];
+        });
+        vector<SharedSubArr> segments;
+        for(SharedSubArr& next : runs){
+            int ref = firstFile(next);
+            bool assigned = false;
+            for(int k=segments.size()-1; k>=0 && !assigned; k--){
+                SharedSubArr& cur = segments[k];
+                if(firstFile(cur) != ref)
+                    break;
+                int shift = next.starts[ref] - cur.starts[ref];
+                int gap = shift - cur.length;
+                if(gap > mergeThreshold)
+                    continue;
+                int common = 0;
+                bool aligned = true;
+                for(int f=0; f<files; f++){
+                    if(f==ref || cur.starts[f]<0 || next.starts[f]<0)
+                        continue;
+                    common++;
+                    if(abs(next.starts[f] - cur.starts[f] - shift) > offsetThreshold)
+                        aligned = false;
+                }
+                if(!common || !aligned || (gap > 0 && !gapMatches(next, ref, gap, shift)))
+                    continue;
+                // shift isn't negative so a start taken from next can only fall in front of its file, that file is left out
+                for(int f=0; f<files; f++){
+                    int start = next.starts[f] - shift;
+                    if(cur.starts[f]<0 && next.starts[f]>=0 && start>=0){
+                        cur.starts[f] = start;
+                        cur.support++;
+                    }
+                }
+                cur.length = std::max(cur.length, shift + next.length);
+                assigned = true;
+            }
+            if(!assigned){
+                segments.push_back(next);
+            }
+        }
+        return segments;
+    };
+    // A run can only join one chain, so a second pass joins chains that ended up overlapping on the same diagonals
+    vector<SharedSubArr> segments = mergeRuns(mergeRuns(shared));
+    segments.erase(
+    std::remove_if(segments.begin(), segments.end(),
+        [delay_item](const SharedSubArr & o) { return o.length <= delay_item; }),
+    segments.end());
+    sort(segments.begin(), segments.end(), [&](const SharedSubArr &a, const SharedSubArr &b) {
+        int fa = firstFile(a); int fb = firstFile(b);
+        return fa != fb ? fa < fb : a.starts[fa] < b.starts[fb];
+    });
+    if(verbose) cout << "Merged substrings " << segments.size() << endl;
+
+    auto toSec = [item_duration, sample_rate](int in) {
+        return (double) in * item_duration / sample_rate;
+    };
+    double delay_sec = (double)delay/sample_rate;
+    vector<SeasonSegment> result;
+    for(SharedSubArr& segment : segments){
+        SeasonSegment cur = (struct SeasonSegment){segment.support, vector<TimeRange>(files, (struct TimeRange){-1, -1})};
+        for(int f=0; f<files; f++){
+            if(segment.starts[f]<0)
+                continue;
+            // The run's length comes from the file it is longest in
+            cur.ranges[f] = (struct TimeRange){
+                toSec(segment.starts[f]),
+                toSec(std::min(segment.starts[f] + segment.length, chromas[f].size)) + delay_sec
+            };
+        }
+        result.push_back(cur);
+    }
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef DEFINED_MATCHER_HPP
+#define DEFINED_MATCHER_HPP
+#include <audio/RawAudio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+struct ChromaArr{
+    uint32_t* arr;
+    int size;
+    bool deleted;
+    // When set arr points into a mapped fingerprint cache file instead of memory from chromaprint
+    void* mapping;
+    size_t mappingSize;
+};
+void freeChromaArr(ChromaArr* input);
+
+// Replaces every value with its rank so the suffix array works on a small alphabet
+// Ranks start at firstRank, the ones below are reserved for sentinels. Takes ownership of arr
+std::tuple<int*, uint32_t*, int> compress(uint32_t* arr, int size, int firstRank = 2);
+
+// Share of the 16 two bit fields a and b agree on
+double compare_gray_codes(uint32_t a, uint32_t b);
+
+// How the two fingerprints of a pair were made
+struct PairInfo{
+    int startShift;
+    int endShift;
+    double lengthSecA;
+    double lengthSecB;
+    int sample_rate;
+    int delay;
+    int item_duration;
+    // Whether the fingerprints begin at the start and run to the end of the files, matches close to an edge
+    // of the file are stretched to it but the edge of a window is left alone
+    bool fromStart;
+    bool toEnd;
+};
+
+// Finds the segments chromaA and chromaB have in common
+// outputRanges[0] gets the ranges in A and outputRanges[1] the ranges in B, in seconds
+void matchPair(ChromaArr chromaA, ChromaArr chromaB, PairInfo info, std::vector<TimeRange> outputRanges[2], bool verbose = false);
+
+// Moves the start of range to the start of the closest silence within tolerance seconds of it and the end to the end of one,
+// so a skipped intro or credits takes the gap around it along
+TimeRange snapToSilence(TimeRange range, const std::vector<TimeRange>& silence, double tolerance);
+
+struct SeasonSegment{
+    // Number of files the segment was found in
+    int support;
+    // One range per file in seconds, start and end are -1 for files without the segment
+    std::vector<TimeRange> ranges;
+};
+
+// Finds the segments shared by at least minSupport of the fingerprints with one generalized suffix array
+// Fingerprints must be untrimmed, segments are sorted by where they start in the first file containing them
+std::vector<SeasonSegment> matchSeason(std::vector<ChromaArr> chromas, int minSupport, int sample_rate, int delay, int item_duration, bool verbose = false);
+
+#endif
@@ -0,0 +1,581 @@
+#include "pipeline.hpp"
+#include <async/thread_pool.hpp>
+#include <audio/FFmpegDecoder.hpp>
+#include <audio/Silence.hpp>
+#include <chromaprint.h>
+#include <chromaprint_setup.hpp>
+#include <chunked_fingerprint.hpp>
+#include <debug.hpp>
+#include <fft.h>
+#include <fingerprint_cache.hpp>
+#include <matcher.hpp>
+#include <resampled_audio.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+using std::cout; using std::endl; using std::vector;
+
+// Caps how many bytes of decoded audio are held at once
+// Every pair needs both of its episodes decoded, so two episodes are always let through
+// even if they don't fit, otherwise a small budget could never finish
+class MemoryBudget{
+public:
+    explicit MemoryBudget(size_t limit) : limit(limit) {}
+
+    void acquire(size_t bytes){
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&]{ return limit == 0 || held < 2 || used + bytes <= limit; });
+        used += bytes;
+        held++;
+    }
+
+    // Swaps a reservation for the size the audio really takes once it is decoded
+    void resize(size_t from, size_t to){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            used = used - from + to;
+        }
+        released.notify_all();
+    }
+
+    void release(size_t bytes){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            used -= bytes;
+            held--;
+        }
+        released.notify_all();
+    }
+
+private:
+    size_t limit;
+    size_t used = 0;
+    int held = 0;
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+class Progress{
+public:
+    void add(double fraction){
+        std::lock_guard<std::mutex> lock(mutex);
+        progress += fraction;
+        if(progress*100 > last_percent_reported){
+            last_percent_reported = (int)(progress*100)+1;
+            cout << "\rProgress: " << last_percent_reported << "% ";
+            cout.flush();
+        }
+    }
+
+private:
+    std::mutex mutex;
+    double progress = 0;
+    int last_percent_reported = 0;
+};
+
+// Sorts ranges and joins the ones that overlap
+static vector<TimeRange> mergeRanges(vector<TimeRange> ranges){
+    std::sort(ranges.begin(), ranges.end(), sortByStart);
+    vector<TimeRange> merged;
+    for(TimeRange cur : ranges){
+        if(!merged.empty() && cur.start <= merged.back().end)
+            merged.back().end = std::max(merged.back().end, cur.end);
+        else
+            merged.push_back(cur);
+    }
+    return merged;
+}
+
+constexpr int fingerprintAlgorithm = CHROMAPRINT_ALGORITHM_TEST5;
+// Identical audio longer than this at the start or end of two files is left to the fingerprints
+constexpr double maxTrimSec = 16;
+
+struct WorkerContext{
+    ChromaprintContext* ctx = nullptr;
+    ~WorkerContext(){
+        if(ctx)
+            chromaprint_free(ctx);
+    }
+};
+
+// Each worker keeps one context and restarts it for every file it fingerprints
+static ChromaprintContext* workerContext(int sample_rate){
+    thread_local WorkerContext worker;
+    if(!worker.ctx)
+        worker.ctx = newChromaprintContext(fingerprintAlgorithm, sample_rate);
+    return worker.ctx;
+}
+
+/*
+Runs decode, trim, fingerprint and match as separate tasks on one thread pool
+
+Pair p compares episode p-1 with episode p, for p in [1, episodes)
+    decode(i)       needs nothing, waits on the memory budget before it is queued
+    trim(p)         needs the audio of both episodes in the pair for the common prefix and suffix
+    fingerprint(i)  needs the trims of pair max(i, 1)
+    match(p)        needs the fingerprints of both episodes in the pair
+
+Audio is freed as soon as its fingerprint and the trims of the next pair are done,
+fingerprints once both pairs using them are matched.
+*/
+class SeasonPipeline{
+public:
+    SeasonPipeline(vector<char*> pathList, PipelineOptions options, AudioRegion region)
+        : paths(pathList), options(options), region(region), budget(options.memoryBudget),
+          episodes(pathList.size()), pairs(pathList.size()), results(pathList.size()) {}
+
+    vector<vector<TimeRange>> run(){
+        runStages();
+        return results;
+    }
+
+    vector<SeasonSegment> runSeason(){
+        runStages();
+        vector<ChromaArr> chromas;
+        for(Episode& episode : episodes)
+            chromas.push_back(episode.chroma);
+        vector<SeasonSegment> segments = matchSeason(chromas, options.minSupport, sample_rate, delay, item_duration, options.verbose);
+        for(Episode& episode : episodes)
+            freeChromaArr(&episode.chroma);
+        for(SeasonSegment& segment : segments){
+            for(int i=0; i<(int)episodes.size(); i++){
+                if(segment.ranges[i].start >= 0){
+                    segment.ranges[i].start += episodes[i].offsetSec;
+                    segment.ranges[i].end += episodes[i].offsetSec;
+                    if(options.snapSec > 0)
+                        segment.ranges[i] = snapToSilence(segment.ranges[i], episodes[i].silence, options.snapSec);
+                }
+            }
+        }
+        return segments;
+    }
+
+private:
+    void runStages(){
+        int threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+        ThreadPool workers(threads);
+        pool = &workers;
+
+        if(options.cacheDir){
+            std::error_code error;
+            std::filesystem::create_directories(options.cacheDir, error);
+        }
+        // Every context made after this shares one plan per frame size
+        if(options.fftWisdom)
+            chromaprint::SetFFTPlanning(chromaprint::FFT_PLAN_PATIENT, options.fftWisdom);
+
+        cout << "Starting Chromaprint\n";
+        for(int i=0; i<(int)paths.size(); i++){
+            std::error_code error;
+            size_t bytes = std::filesystem::file_size(paths[i], error);
+            // Streamed files are never held in memory
+            episodes[i].streamed = isStreamedFile(paths[i]);
+            episodes[i].reserved = error || episodes[i].streamed ? 0 : bytes;
+            budget.acquire(episodes[i].reserved);
+            pool->submit([this, i]{ decode(i); });
+        }
+        pool->wait();
+        cout << "\nDone\n";
+        pool = nullptr;
+    }
+
+    struct Episode{
+        RawAudio audio;
+        // Replaces audio, which is freed right after decoding, when options.resampleOnRead is set
+        ResampledAudio resampled;
+        ChromaArr chroma;
+        size_t reserved = 0;
+        double lengthSec = 0;
+        double offsetSec = 0;
+        // Kept after the audio is freed, matching only needs these
+        vector<TimeRange> silence;
+        // Decoded by FFmpeg straight into the fingerprinter, audio only holds the sample rate
+        bool streamed = false;
+        bool decoded = false;
+        bool fingerprinted = false;
+        bool audioFreed = false;
+        bool chromaFreed = false;
+    };
+
+    struct Pair{
+        int startShift = 0;
+        int endShift = 0;
+        bool trimmed = false;
+        bool matchQueued = false;
+        bool matched = false;
+    };
+
+    int lastPair() const { return (int)paths.size() - 1; }
+
+    // Season mode matches every fingerprint at once after the pool drains instead of pair by pair
+    bool seasonMode() const { return options.minSupport > 0; }
+
+    void decode(int i){
+        // Streamed files are decoded while they are fingerprinted, for now only their sample rate is needed
+        RawAudio audio;
+        if(episodes[i].streamed)
+            audio = (struct RawAudio){nullptr, {}, paths[i], probeSampleRate(paths[i]), 1, 0, 0, 0, true, nullptr, 0};
+        else
+            audio = audioFileToArr(paths[i], region);
+        bool resampling = options.resampleOnRead && !episodes[i].streamed;
+        ResampledAudio resampled;
+        if(resampling)
+            resampled = resampleAudio(audio, fingerprintAlgorithm, (int)(maxTrimSec*audio.sample_rate) + 1);
+        vector<int> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Episode& episode = episodes[i];
+            if(sample_rate<0)
+                sample_rate = audio.sample_rate;
+            ASSERT(sample_rate == audio.sample_rate, "Tracks must have the same sample rate");
+            // FFmpeg downmixes streamed files, so only files read whole have to agree on channels
+            if(!episode.streamed){
+                if(channels<0)
+                    channels = audio.channels;
+                ASSERT(channels == audio.channels, "Tracks must have the same number of channels");
+                episode.lengthSec = audio.lengthSec;
+                episode.offsetSec = audio.offsetSec;
+                episode.silence = audio.silence;
+                reportSilence(i);
+            }
+            if(resampling){
+                freeRawAudio(&audio);
+                episode.resampled = std::move(resampled);
+                size_t bytes = resampledBytes(episode.resampled);
+                budget.resize(episode.reserved, bytes);
+                episode.reserved = bytes;
+            }
+            episode.audio = audio;
+            episode.decoded = true;
+            for(int p=std::max(i, 1); p<=std::min(i+1, lastPair()); p++){
+                if(episodes[p-1].decoded && episodes[p].decoded)
+                    ready.push_back(p);
+            }
+        }
+        for(int p : ready)
+            pool->submit([this, p]{ trim(p); });
+    }
+
+    void trim(int p){
+        // Season matching needs the whole of every file, audio shared by two files is still shared by the rest
+        // Streamed files have no samples to compare
+        if(seasonMode() || episodes[p-1].streamed || episodes[p].streamed){
+            trimmed(p, 0, 0);
+            return;
+        }
+        RawAudio& audioA = episodes[p-1].audio; RawAudio& audioB = episodes[p].audio;
+        int sample_rate = audioA.sample_rate;
+        int startShift, endShift;
+        if(options.resampleOnRead){
+            // Only the edges are left, they are long enough to tell when a shift is over maxTrimSec
+            startShift = getCommonPrefix(episodes[p-1].resampled, episodes[p].resampled);
+            endShift = getCommonSuffix(episodes[p-1].resampled, episodes[p].resampled);
+        }
+        else{
+            startShift = getCommonPrefix(audioA, audioB);
+            endShift = getCommonSuffix(audioA, audioB);
+        }
+        // A window can be the same in two different files, so only whole files are checked
+        ASSERT(!isWholeFile(region) || !(audioA.length==audioB.length && audioA.length==startShift), "Audio files are the same");
+        // The prefix and suffix overlap when the windows are the same, trim each sample only once
+        endShift = std::min(endShift, std::min(audioA.length, audioB.length)/audioA.channels - startShift);
+        double startShiftsec = (double) startShift/sample_rate; double endShiftsec = (double) endShift/sample_rate;
+        if(options.verbose){
+            std::lock_guard<std::mutex> lock(mutex);
+            cout << audioA.filename << " " << audioB.filename << endl;
+            cout << "START Shift " << startShiftsec << endl << "END Shift " << endShiftsec << endl;
+        }
+        // At this size  chromaprint would give you better accuracy than raw wav matching
+        if(startShiftsec>maxTrimSec){
+            startShift = 0;
+        }
+        if(endShiftsec>maxTrimSec){
+            endShift = 0;
+        }
+
+        trimmed(p, startShift, endShift);
+    }
+
+    void trimmed(int p, int startShift, int endShift){
+        vector<int> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pairs[p].startShift = startShift;
+            pairs[p].endShift = endShift;
+            pairs[p].trimmed = true;
+            // The first pair also decides the trims of the very first episode
+            if(p == 1)
+                ready.push_back(0);
+            ready.push_back(p);
+            releaseAudioIfDone(p-1);
+        }
+        for(int i : ready)
+            pool->submit([this, i]{ fingerprint(i); });
+    }
+
+    void fingerprint(int i){
+        if(episodes[i].streamed){
+            fingerprintStreamed(i);
+            return;
+        }
+        Pair& pair = pairs[std::max(i, 1)];
+        RawAudio& audio = episodes[i].audio;
+        const int16_t* samples = audio.arr;
+        int length = audio.length;
+        int channels = audio.channels; int sample_rate = audio.sample_rate;
+        int startShift = pair.startShift; int endShift = pair.endShift;
+        if(options.resampleOnRead){
+            // Already in the fingerprinter's format, so its resampler passes the samples straight through
+            ResampledAudio& resampled = episodes[i].resampled;
+            int first = resampledIndex(resampled, pair.startShift, sample_rate);
+            int last = resampledIndex(resampled, resampled.frames - pair.endShift, sample_rate);
+            samples = resampled.samples.data();
+            length = (int)resampled.samples.size();
+            channels = 1; sample_rate = resampled.sample_rate;
+            startShift = first; endShift = length - last;
+        }
+        double share = 1.0 / paths.size();
+
+        FingerprintKey key;
+        if(options.cacheDir){
+            key = (struct FingerprintKey){
+                hashPCM(samples, length), fingerprintAlgorithm, sample_rate, channels, startShift, endShift
+            };
+            ChromaArr chroma; int cachedDelay, cachedItemDuration;
+            if(loadCachedFingerprint(options.cacheDir, key, &chroma, &cachedDelay, &cachedItemDuration)){
+                progress.add(share);
+                fingerprinted(i, chroma, cachedDelay, cachedItemDuration);
+                return;
+            }
+        }
+
+        const int16_t *start = samples + startShift*channels;
+        int audioLen = length - (startShift+endShift)*channels;
+        ChromaArr chroma = (struct ChromaArr){nullptr, 0, false, nullptr, 0};
+        int ctxDelay, ctxItemDuration;
+        if(options.fingerprintChunks > 1){
+            chroma = fingerprintChunked(start, audioLen / channels, sample_rate, channels, fingerprintAlgorithm,
+                options.fingerprintChunks, &ctxDelay, &ctxItemDuration);
+            progress.add(share);
+        }
+        else{
+            ChromaprintContext *ctx = workerContext(sample_rate);
+            chromaprint_start(ctx, sample_rate, channels);
+            int chunk_size = 1000 * channels;
+            // Feed and track progress
+            for(int k=0; k<audioLen/chunk_size; k++){
+                chromaprint_feed(ctx, start, chunk_size);
+                start+=chunk_size;
+                progress.add(share * chunk_size / audioLen);
+            }
+            if(audioLen % chunk_size!=0){
+                chromaprint_feed(ctx, start, audioLen % chunk_size);
+            }
+            chromaprint_finish(ctx);
+
+            chromaprint_get_raw_fingerprint(ctx, &chroma.arr, &chroma.size);
+            ctxDelay = chromaprint_get_delay(ctx);
+            ctxItemDuration = chromaprint_get_item_duration(ctx);
+        }
+        if(options.cacheDir && !storeCachedFingerprint(options.cacheDir, key, chroma, ctxDelay, ctxItemDuration)){
+            std::cerr << "Couldn't write fingerprint cache entry for " << paths[i] << endl;
+        }
+        fingerprinted(i, chroma, ctxDelay, ctxItemDuration);
+    }
+
+    // Feeds the decoder output straight to the fingerprinter, so the file is never in memory as a whole
+    // The cache is skipped since its key is a hash of the samples, and so is splitting into chunks
+    void fingerprintStreamed(int i){
+        int sample_rate = episodes[i].audio.sample_rate;
+        ChromaprintContext *ctx = workerContext(sample_rate);
+        chromaprint_start(ctx, sample_rate, 1);
+        SilenceDetector detector(sample_rate, 1);
+        size_t first;
+        size_t frames = streamAudioFile(paths[i], sample_rate, region, [&](const int16_t* data, size_t size){
+            chromaprint_feed(ctx, data, (int)size);
+            detector.feed(data, size);
+        }, &first);
+        chromaprint_finish(ctx);
+
+        ChromaArr chroma = (struct ChromaArr){nullptr, 0, false, nullptr, 0};
+        chromaprint_get_raw_fingerprint(ctx, &chroma.arr, &chroma.size);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Episode& episode = episodes[i];
+            episode.lengthSec = (double)frames/sample_rate;
+            episode.offsetSec = (double)first/sample_rate;
+            episode.silence = detector.finish();
+            for(TimeRange& gap : episode.silence){
+                gap.start += episode.offsetSec;
+                gap.end += episode.offsetSec;
+            }
+            reportSilence(i);
+        }
+        progress.add(1.0 / paths.size());
+        fingerprinted(i, chroma, chromaprint_get_delay(ctx), chromaprint_get_item_duration(ctx));
+    }
+
+    // Must hold mutex
+    void reportSilence(int i){
+        if(!options.verbose)
+            return;
+        cout << paths[i] << " silence";
+        for(TimeRange gap : episodes[i].silence)
+            cout << " " << gap.start << "-" << gap.end;
+        cout << endl;
+    }
+
+    void fingerprinted(int i, ChromaArr chroma, int ctxDelay, int ctxItemDuration){
+        vector<int> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(delay<0){
+                delay = ctxDelay;
+                item_duration = ctxItemDuration;
+            }
+            ASSERT(delay == ctxDelay, "Delay Mismatch\n");
+            ASSERT(item_duration == ctxItemDuration, "Item Duration Mismatch\n");
+
+            episodes[i].chroma = chroma;
+            episodes[i].fingerprinted = true;
+            releaseAudioIfDone(i);
+            for(int p=std::max(i, 1); p<=std::min(i+1, lastPair()); p++){
+                if(!seasonMode() && episodes[p-1].fingerprinted && episodes[p].fingerprinted && !pairs[p].matchQueued){
+                    pairs[p].matchQueued = true;
+                    ready.push_back(p);
+                }
+            }
+        }
+        for(int p : ready)
+            pool->submit([this, p]{ match(p); });
+    }
+
+    void match(int p){
+        // Keeps the order the old two slot window compared files in, so results stay identical:
+        // odd pairs put the older episode first, even pairs the newer one
+        int a = p%2 ? p-1 : p;
+        int b = p%2 ? p : p-1;
+        PairInfo info;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            info = (struct PairInfo){
+                pairs[p].startShift, pairs[p].endShift,
+                episodes[a].lengthSec, episodes[b].lengthSec,
+                sample_rate, delay, item_duration,
+                episodes[a].offsetSec == 0 && episodes[b].offsetSec == 0, region.length <= 0
+            };
+        }
+
+        vector<TimeRange> outputRanges[2];
+        matchPair(episodes[a].chroma, episodes[b].chroma, info, outputRanges, options.verbose);
+
+        // Ranges are relative to the start of the loaded region, and the delay added to the end of a match
+        // can run past a window
+        Episode* pairEpisodes[2] = {&episodes[a], &episodes[b]};
+        for(int k=0; k<2; k++){
+            for(TimeRange& range : outputRanges[k]){
+                if(!isWholeFile(region))
+                    range.end = std::min(range.end, pairEpisodes[k]->lengthSec);
+                range.start += pairEpisodes[k]->offsetSec;
+                range.end += pairEpisodes[k]->offsetSec;
+                if(options.snapSec > 0)
+                    range = snapToSilence(range, pairEpisodes[k]->silence, options.snapSec);
+            }
+            // Two ranges snapped to either side of the same gap now share it
+            if(options.snapSec > 0)
+                outputRanges[k] = mergeRanges(outputRanges[k]);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        results[p] = outputRanges[p%2 ? 1 : 0];
+        if(p == 1)
+            results[0] = outputRanges[0];
+        pairs[p].matched = true;
+        releaseChromaIfDone(p-1);
+        releaseChromaIfDone(p);
+    }
+
+    // Must hold mutex
+    void releaseAudioIfDone(int i){
+        Episode& episode = episodes[i];
+        if(episode.audioFreed || !episode.fingerprinted || (i < lastPair() && !pairs[i+1].trimmed))
+            return;
+        freeRawAudio(&episode.audio);
+        episode.resampled = ResampledAudio();
+        episode.audioFreed = true;
+        budget.release(episode.reserved);
+    }
+
+    // Must hold mutex
+    void releaseChromaIfDone(int i){
+        Episode& episode = episodes[i];
+        if(episode.chromaFreed || (i > 0 && !pairs[i].matched) || (i < lastPair() && !pairs[i+1].matched))
+            return;
+        freeChromaArr(&episode.chroma);
+        episode.chromaFreed = true;
+    }
+
+    vector<char*> paths;
+    PipelineOptions options;
+    AudioRegion region;
+    MemoryBudget budget;
+    Progress progress;
+    ThreadPool* pool = nullptr;
+
+    std::mutex mutex;
+    vector<Episode> episodes;
+    vector<Pair> pairs;
+    vector<vector<TimeRange>> results;
+    int channels = -1;
+    int sample_rate = -1;
+    int delay = -1;
+    int item_duration = -1;
+};
+
+// Whole files, or the head and tail windows of every file when either is set
+static vector<AudioRegion> regionsToMatch(const PipelineOptions& options){
+    if(options.headSec <= 0 && options.tailSec <= 0)
+        return {wholeFile};
+    vector<AudioRegion> regions;
+    if(options.headSec > 0)
+        regions.push_back((struct AudioRegion){0, options.headSec});
+    if(options.tailSec > 0)
+        regions.push_back((struct AudioRegion){-options.tailSec, 0});
+    return regions;
+}
+
+vector<vector<TimeRange>> findSubstrings(vector<char*> pathList, PipelineOptions options){
+    options.minSupport = 0;
+    vector<AudioRegion> regions = regionsToMatch(options);
+    if(isWholeFile(regions[0])){
+        SeasonPipeline pipeline(pathList, options, wholeFile);
+        return pipeline.run();
+    }
+
+    vector<vector<TimeRange>> results(pathList.size());
+    for(AudioRegion region : regions){
+        SeasonPipeline pipeline(pathList, options, region);
+        vector<vector<TimeRange>> regionResults = pipeline.run();
+        for(int i=0; i<(int)pathList.size(); i++)
+            results[i].insert(results[i].end(), regionResults[i].begin(), regionResults[i].end());
+    }
+    for(vector<TimeRange>& ranges : results)
+        ranges = mergeRanges(ranges);
+    return results;
+}
+
+vector<SeasonSegment> findSeasonSegments(vector<char*> pathList, PipelineOptions options){
+    ASSERT(options.minSupport >= 2 && options.minSupport <= (int)pathList.size(), "Support must be between 2 and the number of files");
+    // Windows are matched on their own, so a segment never spans two of them
+    vector<SeasonSegment> segments;
+    for(AudioRegion region : regionsToMatch(options)){
+        SeasonPipeline pipeline(pathList, options, region);
+        vector<SeasonSegment> regionSegments = pipeline.runSeason();
+        segments.insert(segments.end(), regionSegments.begin(), regionSegments.end());
+    }
+    return segments;
+}
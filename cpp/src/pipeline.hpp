@@ -0,0 +1,41 @@
+#ifndef DEFINED_PIPELINE_HPP
+#define DEFINED_PIPELINE_HPP
+#include <audio/RawAudio.hpp>
+#include <matcher.hpp>
+#include <cstddef>
+#include <vector>
+
+struct PipelineOptions{
+    // Worker threads shared by every stage, 0 picks one per core
+    int threads;
+    // Bytes of decoded audio allowed in flight, 0 means no limit
+    size_t memoryBudget;
+    // Directory of the on-disk fingerprint cache, nullptr disables it
+    const char* cacheDir;
+    // Season mode only, how many files a segment has to appear in
+    int minSupport;
+    // Splits every file into this many chunks fingerprinted in parallel, 1 or less fingerprints serially
+    int fingerprintChunks;
+    // FFTW wisdom file, plans missing from it are measured patiently and saved back, nullptr plans by estimate
+    const char* fftWisdom;
+    // Seconds at the start and end of every file to look for intros and credits in, the rest is never read
+    // 0 for both loads whole files
+    double headSec;
+    double tailSec;
+    // Moves the edges of every range onto silences at most this many seconds away, 0 leaves them where matching put them
+    double snapSec;
+    // Keeps each file only in the fingerprinter's mono format once read, plus the few seconds at its edges
+    // the raw comparison needs. Uses less memory for stereo and high rate files
+    bool resampleOnRead;
+    bool verbose;
+};
+
+// Compares every file with the one before it in pathList
+// Returns the repeated time ranges of each file, in the same order as pathList
+// With a head or tail window only those regions are matched, ranges are still in seconds from the start of the file
+std::vector<std::vector<TimeRange>> findSubstrings(std::vector<char*> pathList, PipelineOptions options);
+
+// Matches all files at once and returns the segments shared by at least options.minSupport of them
+std::vector<SeasonSegment> findSeasonSegments(std::vector<char*> pathList, PipelineOptions options);
+
+#endif
@@ -0,0 +1,69 @@
+#include "resampled_audio.hpp"
+#include <audio/SampleCompare.hpp>
+#include <audio_processor.h>
+#include <chromaprint_setup.hpp>
+#include <fingerprinter.h>
+#include <fingerprinter_configuration.h>
+#include <algorithm>
+#include <memory>
+
+// Appends everything the processor puts out
+class SampleCollector : public chromaprint::AudioConsumer{
+public:
+    explicit SampleCollector(vector<int16_t>* out) : out(out) {}
+    void Consume(const int16_t* input, int length) override{
+        out->insert(out->end(), input, input + length);
+    }
+
+private:
+    vector<int16_t>* out;
+};
+
+// Only the configuration is made, a whole fingerprinter would plan an FFT just to be asked its rate
+static int targetSampleRate(int algorithm, int sample_rate){
+    std::unique_ptr<chromaprint::FingerprinterConfiguration> config(newFingerprinterConfiguration(algorithm, sample_rate));
+    return chromaprint::Fingerprinter::GetTargetSampleRate(config.get());
+}
+
+ResampledAudio resampleAudio(const RawAudio& audio, int algorithm, int edgeFrames){
+    ResampledAudio resampled;
+    resampled.channels = audio.channels;
+    resampled.frames = audio.length / audio.channels;
+    resampled.sample_rate = targetSampleRate(algorithm, audio.sample_rate);
+
+    size_t edge = (size_t)std::min(resampled.frames, edgeFrames) * audio.channels;
+    resampled.head.assign(audio.arr, audio.arr + edge);
+    resampled.tail.assign(audio.arr + audio.length - edge, audio.arr + audio.length);
+
+    resampled.samples.reserve((size_t)((int64_t)resampled.frames * resampled.sample_rate / audio.sample_rate) + 1);
+    SampleCollector collector(&resampled.samples);
+    chromaprint::AudioProcessor processor(resampled.sample_rate, &collector);
+    processor.Reset(audio.sample_rate, audio.channels);
+    // Whole buffers at a time, the processor copies into one anyway. The edges are copied already,
+    // so a mapped file never holds more than one block of the original
+    const int block = 32768 * audio.channels;
+    for(int i = 0; i < audio.length; i += block){
+        int count = std::min(block, audio.length - i);
+        processor.Consume(audio.arr + i, count);
+        releaseSamples(audio, i, count);
+    }
+    processor.Flush();
+    resampled.samples.shrink_to_fit();
+    return resampled;
+}
+
+size_t resampledBytes(const ResampledAudio& audio){
+    return (audio.samples.size() + audio.head.size() + audio.tail.size()) * sizeof(int16_t);
+}
+
+int resampledIndex(const ResampledAudio& audio, int frame, int sample_rate){
+    return (int)std::min<int64_t>((int64_t)frame * audio.sample_rate / sample_rate, audio.samples.size());
+}
+
+int getCommonPrefix(const ResampledAudio& audioA, const ResampledAudio& audioB){
+    return (int)(commonPrefixLength(audioA.head, audioB.head)/audioA.channels);
+}
+
+int getCommonSuffix(const ResampledAudio& audioA, const ResampledAudio& audioB){
+    return (int)(commonSuffixLength(audioA.tail, audioB.tail)/audioA.channels);
+}
@@ -0,0 +1,30 @@
+#ifndef DEFINED_RESAMPLED_AUDIO_HPP
+#define DEFINED_RESAMPLED_AUDIO_HPP
+#include <audio/RawAudio.hpp>
+#include <cstdint>
+#include <vector>
+
+// A file the way the fingerprinter sees it, downmixed and resampled once when it is read
+// Only the edges of the original samples are kept, enough to find the audio it shares with another file
+struct ResampledAudio{
+    // Mono at sample_rate, the fingerprinter's own rate, so feeding it skips the resampler
+    vector<int16_t> samples;
+    int sample_rate;
+    // Interleaved frames from the start and end of the original audio, both hold all of it for short files
+    vector<int16_t> head;
+    vector<int16_t> tail;
+    int channels;
+    int frames;
+};
+
+// Runs audio through the same AudioProcessor a fingerprinter for algorithm uses,
+// keeping edgeFrames original frames at either end
+ResampledAudio resampleAudio(const RawAudio& audio, int algorithm, int edgeFrames);
+size_t resampledBytes(const ResampledAudio& audio);
+// Index in samples of original frame
+int resampledIndex(const ResampledAudio& audio, int frame, int sample_rate);
+// Identical frames at the start/end of both files, at most the edge length
+int getCommonPrefix(const ResampledAudio& audioA, const ResampledAudio& audioB);
+int getCommonSuffix(const ResampledAudio& audioA, const ResampledAudio& audioB);
+
+#endif
@@ -0,0 +1,154 @@
+#include "suffix_array.hpp"
+#include <algorithm>
+
+/*
+SA-IS by Nong, Zhang and Chan
+Suffixes are classified as S (smaller than the next suffix) or L (larger)
+An LMS position is an S position whose left neighbour is L
+Sorting just the LMS substrings is enough to induce the order of every other suffix,
+and when two LMS substrings are equal the order between them comes from recursing on the
+string of LMS substring names, which is at most half as long
+The end of the string acts as a virtual sentinel smaller than everything, so s needs no terminator
+
+Besides SA itself only the types and two bucket arrays are needed per level,
+the names and the reduced string live in the unused half of SA
+*/
+
+template<typename Index>
+static inline bool isLMS(const std::vector<uint8_t>& types, Index i){
+    return i > 0 && types[i] && !types[i-1];
+}
+
+// Expects the LMS positions to already be at the end of their buckets, everything else -1
+template<typename Char, typename Index>
+static void induce(const Char* s, Index n, Index K, Index* SA, SuffixArrayLevel<Index>& level){
+    const std::vector<uint8_t>& types = level.types;
+    std::vector<Index>& bucket = level.bucket;
+    // L positions from left to right, the last suffix is L and follows the virtual sentinel
+    std::copy(level.bucketStart.begin(), level.bucketStart.begin() + K, bucket.begin());
+    SA[bucket[s[n-1]]++] = n-1;
+    for(Index i = 0; i < n; i++){
+        Index v = SA[i];
+        if(v >= 1 && !types[v-1])
+            SA[bucket[s[v-1]]++] = v-1;
+    }
+    // S positions from right to left, filling each bucket from its end
+    std::copy(level.bucketStart.begin() + 1, level.bucketStart.end(), bucket.begin());
+    for(Index i = n-1; i >= 0; i--){
+        Index v = SA[i];
+        if(v >= 1 && types[v-1])
+            SA[--bucket[s[v-1]]] = v-1;
+    }
+}
+
+template<typename Char, typename Index>
+static void sais(const Char* s, Index n, Index K, Index* SA, SuffixArrayWorkspace<Index>& workspace, size_t depth){
+    if(n == 0)
+        return;
+    if(n == 1){
+        SA[0] = 0;
+        return;
+    }
+    if(workspace.levels.size() <= depth)
+        workspace.levels.emplace_back();
+    SuffixArrayLevel<Index>& level = workspace.levels[depth];
+
+    // types[i] is 1 for S positions
+    std::vector<uint8_t>& types = level.types;
+    types.assign(n, 0);
+    for(Index i = n-2; i >= 0; i--)
+        types[i] = (s[i] == s[i+1]) ? types[i+1] : (s[i] < s[i+1]);
+
+    // Bucket c covers SA[bucketStart[c], bucketStart[c+1])
+    std::vector<Index>& bucketStart = level.bucketStart;
+    std::vector<Index>& bucket = level.bucket;
+    bucketStart.assign(K+1, 0);
+    bucket.resize(K);
+    for(Index i = 0; i < n; i++)
+        bucketStart[s[i]+1]++;
+    for(Index c = 0; c < K; c++)
+        bucketStart[c+1] += bucketStart[c];
+
+    // Sort the LMS substrings
+    std::fill(SA, SA + n, -1);
+    std::copy(bucketStart.begin() + 1, bucketStart.end(), bucket.begin());
+    for(Index i = n-1; i >= 1; i--){
+        if(isLMS(types, i))
+            SA[--bucket[s[i]]] = i;
+    }
+    induce(s, n, K, SA, level);
+
+    Index m = 0;
+    for(Index i = 0; i < n; i++){
+        if(isLMS(types, SA[i]))
+            SA[m++] = SA[i];
+    }
+    if(m == 0)
+        return;
+
+    // Name them in sorted order, equal substrings share a name
+    // LMS positions are at least 2 apart so position/2 gives each a slot in SA[m, n)
+    std::fill(SA + m, SA + n, -1);
+    Index names = 0;
+    Index prev = -1, prevEnd = -1;
+    for(Index i = 0; i < m; i++){
+        Index pos = SA[i];
+        Index end = pos + 1;
+        while(end < n && !isLMS(types, end))
+            end++;
+        bool same = prev != -1 && end != n && prevEnd != n && end - pos == prevEnd - prev;
+        for(Index k = 0; same && k <= end - pos; k++)
+            same = s[pos+k] == s[prev+k];
+        if(!same)
+            names++;
+        SA[m + pos/2] = names - 1;
+        prev = pos; prevEnd = end;
+    }
+    // Gather the names in text order at the end of SA, that is the reduced string
+    for(Index i = n-1, j = n-1; i >= m; i--){
+        if(SA[i] != -1)
+            SA[j--] = SA[i];
+    }
+
+    // m <= n/2 so sorting the reduced string into SA[0, m) never touches it
+    Index* reduced = SA + n - m;
+    if(names < m){
+        sais(reduced, m, names, SA, workspace, depth + 1);
+    }
+    else{
+        for(Index i = 0; i < m; i++)
+            SA[reduced[i]] = i;
+    }
+
+    // Turn the reduced suffix array back into LMS positions
+    for(Index i = 1, j = 0; i < n; i++){
+        if(isLMS(types, i))
+            reduced[j++] = i;
+    }
+    for(Index i = 0; i < m; i++)
+        SA[i] = reduced[SA[i]];
+    std::fill(SA + m, SA + n, -1);
+    // Place them at their bucket ends in reverse order, each one only ever moves right
+    std::copy(bucketStart.begin() + 1, bucketStart.end(), bucket.begin());
+    for(Index i = m-1; i >= 0; i--){
+        Index pos = SA[i];
+        SA[i] = -1;
+        SA[--bucket[s[pos]]] = pos;
+    }
+    induce(s, n, K, SA, level);
+}
+
+template<typename Index>
+void build_suffix_array(const int* s, Index n, int K, Index* SA, SuffixArrayWorkspace<Index>& workspace){
+    sais(s, n, (Index)K, SA, workspace, 0);
+}
+
+template void build_suffix_array<int32_t>(const int*, int32_t, int, int32_t*, SuffixArrayWorkspace<int32_t>&);
+template void build_suffix_array<int64_t>(const int*, int64_t, int, int64_t*, SuffixArrayWorkspace<int64_t>&);
+
+int* suffix_array(const int* s, int n, int K){
+    thread_local SuffixArrayWorkspace<int> workspace;
+    int* SA = new int[n];
+    build_suffix_array<int>(s, n, K, SA, workspace);
+    return SA;
+}
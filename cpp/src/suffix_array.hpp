@@ -0,0 +1,33 @@
+#ifndef DEFINED_SUFFIX_ARRAY_HPP
+#define DEFINED_SUFFIX_ARRAY_HPP
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Scratch buffers for one level of the SA-IS recursion
+template<typename Index>
+struct SuffixArrayLevel{
+    std::vector<uint8_t> types;
+    std::vector<Index> bucketStart, bucket;
+};
+
+// Keeps the buffers of every recursion level alive between builds
+// so building many suffix arrays of similar size only allocates on the first one
+// A workspace must not be shared between threads
+template<typename Index>
+struct SuffixArrayWorkspace{
+    // deque so a level's buffers stay put while deeper levels are added
+    std::deque<SuffixArrayLevel<Index>> levels;
+};
+
+// Suffix array of s[0, n) by induced sorting (SA-IS), O(n) time
+// s must only contain values in [0, K), there is no sentinel requirement
+// SA must have room for n entries
+// Instantiated for int32_t and int64_t, use the 64 bit version when n can pass 2^31
+template<typename Index>
+void build_suffix_array(const int* s, Index n, int K, Index* SA, SuffixArrayWorkspace<Index>& workspace);
+
+// Same as above with a per thread workspace, the result is allocated with new[]
+int* suffix_array(const int* s, int n, int K);
+
+#endif
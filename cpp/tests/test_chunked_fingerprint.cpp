@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <chunked_fingerprint.hpp>
+#include <chromaprint_setup.hpp>
+#include <chromaprint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// The algorithm the pipeline fingerprints with
+static const int algorithm = CHROMAPRINT_ALGORITHM_TEST5;
+
+struct RestartPoints{
+    int inputStep, rowStep, skipRows, lookahead;
+};
+
+static RestartPoints restartPoints(int sample_rate){
+    std::unique_ptr<chromaprint::Fingerprinter> fingerprinter(newFingerprinter(algorithm, sample_rate));
+    RestartPoints points;
+    EXPECT_TRUE(fingerprinter->GetRestartPoints(sample_rate, &points.inputStep, &points.rowStep, &points.skipRows, &points.lookahead));
+    return points;
+}
+
+/*
+Tones that glide and change every few seconds over noise, with short silences,
+and a click on every restart point and one frame either side of it,
+so whatever a chunk starts or stops on differs from the frames around it
+*/
+static std::vector<int16_t> syntheticSignal(int frames, int sample_rate, int channels, int inputStep, unsigned seed){
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0, 600);
+    std::vector<int16_t> samples((size_t)frames * channels);
+    double phase[2] = {0, 0};
+    double frequency = 440;
+    for(int i = 0; i < frames; i++){
+        if(i % (sample_rate * 3) == 0)
+            frequency = 110 + random() % 1500;
+        bool silent = i % (sample_rate * 7) < sample_rate / 4;
+        for(int ch = 0; ch < channels; ch++){
+            phase[ch] += 2 * M_PI * frequency * (1 + 0.5 * ch + 0.1 * sin(i * 2.0 / sample_rate)) / sample_rate;
+            double value = silent ? 0 : 8000 * sin(phase[ch]) + 3000 * sin(2.7 * phase[ch]) + noise(random);
+            int step = i % inputStep;
+            if(step <= 1 || step == inputStep - 1)
+                value = ch ? -30000 : 30000;
+            samples[(size_t)i * channels + ch] = (int16_t)std::clamp(value, -32768.0, 32767.0);
+        }
+    }
+    return samples;
+}
+
+// One chromaprint context fed 1000 frames at a time, like the pipeline does without chunks
+static std::vector<uint32_t> serialFingerprint(const std::vector<int16_t>& samples, int sample_rate, int channels){
+    ChromaprintContext* ctx = newChromaprintContext(algorithm, sample_rate);
+    chromaprint_start(ctx, sample_rate, channels);
+    int length = samples.size();
+    int chunk_size = 1000 * channels;
+    for(int fed = 0; fed < length; fed += chunk_size)
+        chromaprint_feed(ctx, samples.data() + fed, std::min(chunk_size, length - fed));
+    chromaprint_finish(ctx);
+    uint32_t* arr; int size;
+    chromaprint_get_raw_fingerprint(ctx, &arr, &size);
+    std::vector<uint32_t> fingerprint(arr, arr + size);
+    chromaprint_dealloc(arr);
+    chromaprint_free(ctx);
+    return fingerprint;
+}
+
+static void expectSameAsSerial(const std::vector<int16_t>& samples, int sample_rate, int channels, const std::vector<int>& chunkCounts){
+    std::vector<uint32_t> expected = serialFingerprint(samples, sample_rate, channels);
+    ASSERT_FALSE(expected.empty());
+    int frames = samples.size() / channels;
+    for(int chunks : chunkCounts){
+        int delay, item_duration;
+        ChromaArr chroma = fingerprintChunked(samples.data(), frames, sample_rate, channels, algorithm, chunks, &delay, &item_duration);
+        std::vector<uint32_t> actual(chroma.arr, chroma.arr + chroma.size);
+        free(chroma.arr);
+        ASSERT_EQ(expected.size(), actual.size()) << sample_rate << " Hz, " << frames << " frames, " << chunks << " chunks";
+        for(size_t i = 0; i < expected.size(); i++)
+            ASSERT_EQ(expected[i], actual[i]) << sample_rate << " Hz, " << frames << " frames, " << chunks << " chunks, index " << i;
+    }
+}
+
+/*
+A fingerprint row needs eight seconds of audio, so a chunk has to be about nine seconds long
+and every run is slow. The inputs are just long enough for two chunks
+*/
+static const int seconds = 18;
+
+// At the fingerprinter's own rate nothing is resampled and every hop is a restart point
+TEST(ChunkedFingerprint, SameAsSerialWithoutResampling)
+{
+    const int sample_rate = 48000;
+    RestartPoints points = restartPoints(sample_rate);
+    ASSERT_EQ(0, points.lookahead);
+    std::vector<int16_t> samples = syntheticSignal(sample_rate * seconds, sample_rate, 2, points.inputStep, 1);
+    expectSameAsSerial(samples, sample_rate, 2, {2});
+}
+
+/*
+Resampling down the second chunk warms up on mirrored audio and drops its first rows, the first chunk reads lookahead frames
+past its end. The input ends one frame before and right at a restart point plus its lookahead, so the last restart point comes and goes
+*/
+TEST(ChunkedFingerprint, SameAsSerialResamplingDown)
+{
+    const int sample_rate = 96000;
+    RestartPoints points = restartPoints(sample_rate);
+    ASSERT_GT(points.lookahead, 0);
+    ASSERT_GT(points.skipRows, 0);
+    std::vector<int16_t> samples = syntheticSignal(sample_rate * seconds, sample_rate, 2, points.inputStep, 2);
+    int restart = (sample_rate * seconds - points.lookahead) / points.inputStep * points.inputStep;
+    // Full scale right before the chunk edge and a silent row after it, so only the frames before the edge
+    // make the first row there differ from silence
+    int edge = restart / points.inputStep / 2 * points.inputStep;
+    for(int i = edge - 200; i < edge; i++)
+        samples[2*i] = samples[2*i+1] = i % 2 ? 32767 : -32768;
+    std::fill(samples.begin() + 2*edge, samples.begin() + 2*(edge + sample_rate * 8 + 5 * points.inputStep), 0);
+    for(int end : {restart + points.lookahead - 1, restart + points.lookahead}){
+        std::vector<int16_t> cut(samples.begin(), samples.begin() + (size_t)end * 2);
+        expectSameAsSerial(cut, sample_rate, 2, {2});
+    }
+}
+
+// Too short to split, fingerprintChunked falls back to one fingerprinter
+TEST(ChunkedFingerprint, ShortInputStaysSerial)
+{
+    for(int sample_rate : {44100, 48000}){
+        std::vector<int16_t> samples = syntheticSignal(sample_rate * 12, sample_rate, 2, sample_rate, 3);
+        expectSameAsSerial(samples, sample_rate, 2, {2, 8});
+    }
+}
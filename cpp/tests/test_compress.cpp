@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <matcher.hpp>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+// The ranking compress did with a sorted copy and a std::map before the radix sort
+static std::tuple<int*, uint32_t*, int> mapCompress(uint32_t* arr, int size, int firstRank){
+    uint32_t* sorted = new uint32_t[size];
+    std::copy_n(arr, size, sorted);
+    std::sort(sorted, sorted+size);
+    std::map<uint32_t, int> rankMap;
+    int rank = firstRank;
+    for(int i = 0; i < size; i++){
+        if(i==0 || sorted[i]!=sorted[i-1]){
+            rankMap[sorted[i]] = rank;
+            rank++;
+        }
+    }
+    delete[] sorted;
+    int* res = new int[size+3];
+    res[size] = res[size+1] = res[size+2] = 0;
+    for(int i=0; i < size; i++){
+        res[i] = rankMap[arr[i]];
+    }
+    delete[] arr;
+
+    uint32_t* rank_to_val = new uint32_t[rank];
+    for (auto const& x : rankMap){
+        rank_to_val[x.second] = x.first;
+    }
+    return std::make_tuple(res, rank_to_val, rank);
+}
+
+static uint32_t* copyOf(const std::vector<uint32_t>& values){
+    uint32_t* arr = new uint32_t[values.size()];
+    std::copy(values.begin(), values.end(), arr);
+    return arr;
+}
+
+// Both take ownership of their input, so each gets its own copy
+static void expectSameRanks(const std::vector<uint32_t>& values, int firstRank){
+    int size = values.size();
+    int expectedMax, actualMax; int* expected; int* actual; uint32_t* expectedValues; uint32_t* actualValues;
+    std::tie(expected, expectedValues, expectedMax) = mapCompress(copyOf(values), size, firstRank);
+    std::tie(actual, actualValues, actualMax) = compress(copyOf(values), size, firstRank);
+    EXPECT_EQ(expectedMax, actualMax) << "size " << size << " firstRank " << firstRank;
+    // The three zeros past the end are the padding the suffix array expects
+    for(int i = 0; i < size + 3; i++)
+        ASSERT_EQ(expected[i], actual[i]) << "size " << size << " firstRank " << firstRank << " index " << i;
+    for(int rank = firstRank; rank < expectedMax; rank++)
+        ASSERT_EQ(expectedValues[rank], actualValues[rank]) << "size " << size << " firstRank " << firstRank << " rank " << rank;
+    delete[] expected; delete[] expectedValues;
+    delete[] actual; delete[] actualValues;
+}
+
+TEST(Compress, MatchesMapRanking)
+{
+    for(int firstRank : {2, 6})
+        expectSameRanks({5, 3, 5, 1, 3, 3, 9, 0, 9}, firstRank);
+}
+
+TEST(Compress, EmptyAndAllEqual)
+{
+    expectSameRanks({}, 2);
+    expectSameRanks({42}, 2);
+    expectSameRanks(std::vector<uint32_t>(1000, 0), 2);
+    expectSameRanks(std::vector<uint32_t>(1000, UINT32_MAX), 4);
+    expectSameRanks(std::vector<uint32_t>(1000, 0x12345678), 2);
+}
+
+TEST(Compress, ExtremeValues)
+{
+    // Values apart in one byte only, so every pass but one is skipped, and both ends of the 32 bit range
+    expectSameRanks({UINT32_MAX, 0, 0x80000000u, 0x7FFFFFFFu, 1, UINT32_MAX, 0, 0xFFFFFFFEu}, 2);
+    expectSameRanks({0x01000000u, 0x03000000u, 0x02000000u, 0x01000000u}, 2);
+    expectSameRanks({0x00000100u, 0x00000300u, 0x00000200u, 0x00000300u}, 2);
+    expectSameRanks({0xAB000000u, 0x000000ABu, 0x00AB0000u, 0x0000AB00u, 0xAB000000u}, 2);
+}
+
+TEST(Compress, RandomValues)
+{
+    std::mt19937 random(17);
+    for(int round = 0; round < 50; round++){
+        int size = random() % 5000;
+        // Few distinct values give many duplicates, a full 32 bit range gives almost none
+        uint32_t mask = round % 3 == 0 ? 0xFFu : round % 3 == 1 ? 0x00FF00F0u : 0xFFFFFFFFu;
+        std::vector<uint32_t> values(size);
+        for(uint32_t& value : values)
+            value = random() & mask;
+        expectSameRanks(values, 2 + round % 5);
+    }
+}
+
+TEST(Compress, DISABLED_Benchmark)
+{
+    typedef std::chrono::steady_clock Clock;
+    std::mt19937 random(3);
+    // About two hours of fingerprints at 8 per second
+    const int size = 60000;
+    std::vector<uint32_t> values(size);
+    for(uint32_t& value : values)
+        value = random();
+    const int iterations = 100;
+
+    auto start = Clock::now();
+    long long mapSum = 0;
+    for(int n = 0; n < iterations; n++){
+        int max; int* res; uint32_t* rank_to_val;
+        std::tie(res, rank_to_val, max) = mapCompress(copyOf(values), size, 2);
+        mapSum += res[n] + max;
+        delete[] res; delete[] rank_to_val;
+    }
+    const double mapTime = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+    start = Clock::now();
+    long long radixSum = 0;
+    for(int n = 0; n < iterations; n++){
+        int max; int* res; uint32_t* rank_to_val;
+        std::tie(res, rank_to_val, max) = compress(copyOf(values), size, 2);
+        radixSum += res[n] + max;
+        delete[] res; delete[] rank_to_val;
+    }
+    const double radixTime = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+    EXPECT_EQ(mapSum, radixSum);
+    printf("%d values: map %.1f us, radix %.1f us\n", size, mapTime, radixTime);
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <diagonal_merge.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Fingerprints A and B with matches laid out like matchPair does, B starts after A and a sentinel
+struct MergeInput{
+    std::vector<uint32_t> a, b;
+    std::vector<CommonSubArr> matches;
+    int offsetB;
+
+    // Value at a position of the concatenation, the sentinel is -1
+    long long at(int pos) const{
+        if(pos >= offsetB)
+            return b[pos - offsetB];
+        return pos == offsetB - 1 ? -1 : a[pos];
+    }
+};
+
+// The merge loop matchPair had before merge_diagonal_runs, with compare_gray_codes spelled out and the sentinel never agreeing
+static std::vector<CommonSubArr> oldMergeLoop(const MergeInput& input, int mergeThreshold, int offsetThreshold){
+    auto compareIndices = [&input](int x, int y) {
+        long long a = input.at(x), b = input.at(y);
+        if(a < 0 || b < 0)
+            return 0.0;
+        double matched = 0;
+        for(int field=0; field<16; field++)
+            if(((a >> (2*field)) & 3) == ((b >> (2*field)) & 3))
+                matched++;
+        return matched / 16;
+    };
+    std::vector<CommonSubArr> common_substring_list = input.matches;
+    for(int i=common_substring_list.size()-1;i>0;i--){
+        CommonSubArr next = common_substring_list[i];
+        for(int k=i-1; k>=0; k--){
+            CommonSubArr cur = common_substring_list[k];
+            int gap = next.startA - cur.startA - cur.length;
+            if(gap<=mergeThreshold && abs(cur.startA - cur.startB - (next.startA - next.startB)) <= offsetThreshold){
+                if(gap>0){
+                    double match_measure = 0;
+                    for(int j=1; j<=gap; j++){
+                        match_measure+=compareIndices(next.startA-j, next.startB-j);
+                    }
+                    if(match_measure/gap < 0.75){
+                        continue;
+                    }
+                }
+                common_substring_list[i] = (struct CommonSubArr){
+                    cur.startA,
+                    cur.startB,
+                    std::min(next.startA + next.length - cur.startA, next.startB + next.length - cur.startB)
+                };
+                common_substring_list.erase(common_substring_list.begin()+k);
+                break;
+            }
+            if(next.startA-cur.startA>=mergeThreshold)
+                break;
+        }
+    }
+    return common_substring_list;
+}
+
+/*
+B repeats stretches of A on a few diagonals with some fields flipped, so gaps land on both sides of 3/4.
+Matches sit mostly on those diagonals and a few off them, some start right at the beginning of B
+and a run of zero length pads ends the list like in matchPair
+*/
+static MergeInput randomInput(unsigned seed){
+    std::mt19937 rng(seed);
+    MergeInput input;
+    int sizeA = 50 + rng() % 400;
+    int sizeB = 50 + rng() % 400;
+    input.offsetB = sizeA + 1;
+    for(int i=0; i<sizeA; i++)
+        input.a.push_back(rng());
+    for(int i=0; i<sizeB; i++)
+        input.b.push_back(rng());
+    std::vector<int> shifts;
+    for(int d = rng() % 4; d >= 0; d--)
+        shifts.push_back((int)(rng() % sizeB) - (int)(rng() % sizeA));
+    for(int i=0; i<sizeB; i++){
+        int from = i - shifts[rng() % shifts.size()];
+        if(from < 0 || from >= sizeA)
+            continue;
+        uint32_t flips = 0;
+        for(int k=(int)(rng() % 10); k>0; k--)
+            flips |= 1u << (rng() % 32);
+        input.b[i] = input.a[from] ^ flips;
+    }
+
+    for(int m = 5 + rng() % 60; m > 0; m--){
+        int shift = shifts[rng() % shifts.size()] + (int)(rng() % 7) - 3;
+        if(rng() % 8 == 0)
+            shift = (int)(rng() % sizeB) - (int)(rng() % sizeA);
+        int startA = rng() % sizeA;
+        int startB = startA + shift;
+        if(rng() % 10 == 0){
+            startB = rng() % 3;
+            startA = startB - shift;
+        }
+        if(startA < 0 || startA >= sizeA || startB < 0 || startB >= sizeB)
+            continue;
+        int length = std::min({(int)(rng() % 20), sizeA - startA, sizeB - startB});
+        input.matches.push_back((struct CommonSubArr){startA, input.offsetB + startB, length});
+    }
+    std::sort(input.matches.begin(), input.matches.end(), [](const CommonSubArr& x, const CommonSubArr& y){
+        return x.startA + x.startB < y.startA + y.startB;
+    });
+    if(!input.matches.empty()){
+        int step = rng() % 3;
+        for(int i=0; i<10; i++){
+            CommonSubArr pad = (struct CommonSubArr){input.matches.back().startA + step, input.matches.back().startB + step, 0};
+            if(pad.startA >= sizeA || pad.startB >= input.offsetB + sizeB)
+                break;
+            input.matches.push_back(pad);
+        }
+    }
+    return input;
+}
+
+static void expectSameRuns(const std::vector<CommonSubArr>& expected, const std::vector<CommonSubArr>& actual, unsigned seed){
+    ASSERT_EQ(expected.size(), actual.size()) << "seed " << seed;
+    for(size_t i = 0; i < expected.size(); i++){
+        EXPECT_EQ(expected[i].startA, actual[i].startA) << "seed " << seed << " index " << i;
+        EXPECT_EQ(expected[i].startB, actual[i].startB) << "seed " << seed << " index " << i;
+        EXPECT_EQ(expected[i].length, actual[i].length) << "seed " << seed << " index " << i;
+    }
+}
+
+TEST(DiagonalMerge, MatchesOldLoopOnRandomLists)
+{
+    int merges = 0;
+    for(unsigned seed = 0; seed < 20000; seed++){
+        MergeInput input = randomInput(seed);
+        int mergeThreshold = 1 + seed % 40;
+        int offsetThreshold = 2 + seed % 3;
+        std::vector<CommonSubArr> expected = oldMergeLoop(input, mergeThreshold, offsetThreshold);
+        std::vector<CommonSubArr> actual = merge_diagonal_runs(input.matches, input.a.data(), input.b.data(), input.offsetB, mergeThreshold, offsetThreshold);
+        expectSameRuns(expected, actual, seed);
+        if(HasFailure())
+            return;
+        merges += input.matches.size() - expected.size();
+    }
+    // The inputs have to exercise the merge for the comparison to mean anything
+    EXPECT_GT(merges, 100000);
+}
+
+TEST(DiagonalMerge, StopsAtFirstMatchFarBehind)
+{
+    MergeInput input;
+    input.offsetB = 101;
+    input.a.assign(100, 0);
+    input.b.assign(100, 0);
+    // The middle match is on another diagonal and mergeThreshold behind the last one, so the first is never reached
+    input.matches = {
+        (struct CommonSubArr){0, 101 + 0, 10},
+        (struct CommonSubArr){2, 101 + 60, 3},
+        (struct CommonSubArr){45, 101 + 45, 10},
+    };
+    std::vector<CommonSubArr> merged = merge_diagonal_runs(input.matches, input.a.data(), input.b.data(), input.offsetB, 40, 2);
+    expectSameRuns(oldMergeLoop(input, 40, 2), merged, 0);
+    EXPECT_EQ(3u, merged.size());
+
+    // Without the match in between the gap of 35 is bridged
+    input.matches.erase(input.matches.begin() + 1);
+    merged = merge_diagonal_runs(input.matches, input.a.data(), input.b.data(), input.offsetB, 40, 2);
+    ASSERT_EQ(1u, merged.size());
+    EXPECT_EQ(0, merged[0].startA);
+    EXPECT_EQ(55, merged[0].length);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <gray_code.hpp>
+#include <random>
+#include <vector>
+
+// Field by field, the way compare_gray_codes counted before the kernels
+static int referenceCount(uint32_t a, uint32_t b){
+    int matched = 0;
+    for(int field=0; field<16; field++)
+        if(((a >> (2*field)) & 3) == ((b >> (2*field)) & 3))
+            matched++;
+    return matched;
+}
+
+// b is a with a few bits flipped, so the counts cover the whole 0 to 16 range instead of sitting near chance
+struct FingerprintPair{
+    std::vector<uint32_t> a, b;
+
+    FingerprintPair(int length, unsigned seed){
+        std::mt19937 rng(seed);
+        for(int i=0; i<length; i++){
+            uint32_t word = rng();
+            uint32_t flips = 0;
+            for(int k=(int)(rng() % 24); k>0; k--)
+                flips |= 1u << (rng() % 32);
+            a.push_back(word);
+            b.push_back(word ^ flips);
+        }
+    }
+};
+
+TEST(GrayCode, KernelsMatchReference) {
+    // Every tail length past 32 words, starting off the vector alignment too
+    for(const GrayCodeKernels& kernel : gray_code_kernels()){
+        for(int length=0; length<=70; length++){
+            for(int offset=0; offset<3; offset++){
+                FingerprintPair pair(length + offset, length * 3 + offset);
+                const uint32_t* a = pair.a.data() + offset;
+                const uint32_t* b = pair.b.data() + offset;
+                int expected = 0;
+                std::vector<uint8_t> counts(length + 1, 0xFF);
+                kernel.counts(a, b, length, counts.data());
+                for(int i=0; i<length; i++){
+                    int count = referenceCount(a[i], b[i]);
+                    expected += count;
+                    ASSERT_EQ(count, counts[i]) << kernel.name << " length " << length << " index " << i;
+                }
+                EXPECT_EQ(0xFF, counts[length]) << kernel.name << " wrote past length " << length;
+                EXPECT_EQ(expected, kernel.matches(a, b, length)) << kernel.name << " length " << length;
+            }
+        }
+    }
+}
+
+TEST(GrayCode, KernelsAgreeOnLongInput) {
+    FingerprintPair pair(100003, 7);
+    std::vector<GrayCodeKernels> kernels = gray_code_kernels();
+    std::vector<uint8_t> expected(pair.a.size()), counts(pair.a.size());
+    kernels[0].counts(pair.a.data(), pair.b.data(), pair.a.size(), expected.data());
+    int expectedMatches = kernels[0].matches(pair.a.data(), pair.b.data(), pair.a.size());
+    for(const GrayCodeKernels& kernel : kernels){
+        kernel.counts(pair.a.data(), pair.b.data(), pair.a.size(), counts.data());
+        EXPECT_EQ(expected, counts) << kernel.name;
+        EXPECT_EQ(expectedMatches, kernel.matches(pair.a.data(), pair.b.data(), pair.a.size())) << kernel.name;
+    }
+}
+
+TEST(GrayCode, SimilarityCurveMatchesWindowSums) {
+    FingerprintPair pair(203, 11);
+    for(int window : {1, 5, 16, 40}){
+        for(int step : {1, 3, 16, 50}){
+            std::vector<double> curve = gray_code_similarity(pair.a, pair.b, window, step);
+            ASSERT_EQ((size_t)((203 - window) / step + 1), curve.size()) << "window " << window << " step " << step;
+            for(size_t w=0; w<curve.size(); w++){
+                int matched = gray_code_matches(pair.a.data() + w*step, pair.b.data() + w*step, window);
+                EXPECT_DOUBLE_EQ(matched / (16.0 * window), curve[w]) << "window " << window << " step " << step << " entry " << w;
+            }
+        }
+    }
+}
+
+TEST(GrayCode, SimilarityCurveStopsAtShorterInput) {
+    FingerprintPair pair(30, 3);
+    std::span<const uint32_t> shorter(pair.b.data(), 12);
+    EXPECT_EQ(3u, gray_code_similarity(pair.a, shorter, 10, 1).size());
+    EXPECT_TRUE(gray_code_similarity(pair.a, shorter, 13, 1).empty());
+    EXPECT_TRUE(gray_code_similarity(pair.a, pair.b, 0, 1).empty());
+    EXPECT_TRUE(gray_code_similarity(pair.a, pair.b, 5, 0).empty());
+}
@@ -0,0 +1,388 @@
+#include <gtest/gtest.h>
+#include <linear_longest_substring.hpp>
+#include <matcher.hpp>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/*
+longest_common_substring only reads the two suffixes next to each lcp entry,
+so a match is laid out as its start in B followed by its start in A
+*/
+struct MatchInput{
+    std::vector<int> suffixArr;
+    std::vector<LcpEntry> entries;
+
+    void add(int startA, int startB, int length){
+        suffixArr.push_back(startB);
+        suffixArr.push_back(startA);
+        entries.push_back((struct LcpEntry){(int)suffixArr.size() - 1, length});
+    }
+};
+
+// Checks every stored match, the way matches were filtered before they were indexed
+static std::vector<CommonSubArr> naiveLongestCommonSubstring(const MatchInput& input, int sizeA){
+    std::vector<CommonSubArr> substrings;
+    for(const LcpEntry& entry : input.entries){
+        CommonSubArr cur = (struct CommonSubArr){input.suffixArr[entry.index], input.suffixArr[entry.index-1], entry.length};
+        if(cur.startA >= sizeA)
+            std::swap(cur.startA, cur.startB);
+        size_t slot = 0;
+        for(; slot < substrings.size(); slot++){
+            const CommonSubArr& old = substrings[slot];
+            bool inA = old.startA <= cur.startA + cur.length && cur.startA <= old.startA + old.length;
+            bool inB = old.startB <= cur.startB + cur.length && cur.startB <= old.startB + old.length;
+            if(inA || inB)
+                break;
+        }
+        if(slot == substrings.size())
+            substrings.push_back(cur);
+        else if(substrings[slot].length < cur.length)
+            substrings[slot] = cur;
+    }
+    std::sort(substrings.begin(), substrings.end(), [](const CommonSubArr& a, const CommonSubArr& b){
+        return a.startA + a.startB < b.startA + b.startB;
+    });
+    return substrings;
+}
+
+static void expectSameMatches(const std::vector<CommonSubArr>& expected, const std::vector<CommonSubArr>& actual){
+    ASSERT_EQ(expected.size(), actual.size());
+    for(size_t i = 0; i < expected.size(); i++){
+        EXPECT_EQ(expected[i].startA, actual[i].startA) << "Matches differ at index " << i;
+        EXPECT_EQ(expected[i].startB, actual[i].startB) << "Matches differ at index " << i;
+        EXPECT_EQ(expected[i].length, actual[i].length) << "Matches differ at index " << i;
+    }
+}
+
+TEST(LongestCommonSubstring, LongMatchThenManyShort)
+{
+    const int sizeA = 100000;
+    MatchInput input;
+    // An intro long enough to cover a fifth of A, then short matches on either side of it and inside it
+    input.add(1000, sizeA + 1 + 3000, 20000);
+    for(int i = 0; i < 20000; i++){
+        int startA = (i * 37) % (sizeA - 10);
+        int startB = sizeA + 1 + (i * 53) % (sizeA - 10);
+        input.add(startA, startB, 1 + i % 4);
+    }
+    std::vector<CommonSubArr> actual = longest_common_substring(input.suffixArr.data(), input.entries, sizeA);
+    expectSameMatches(naiveLongestCommonSubstring(input, sizeA), actual);
+
+    // Nothing inside the intro survives next to it
+    for(const CommonSubArr& match : actual){
+        if(match.length == 20000)
+            continue;
+        EXPECT_TRUE(match.startA + match.length < 1000 || match.startA > 21000) << "Kept " << match.startA;
+    }
+}
+
+TEST(LongestCommonSubstring, ReplacedMatchesOverlapOthers)
+{
+    const int sizeA = 50;
+    MatchInput input;
+    input.add(0, 51, 2);
+    input.add(10, 61, 2);
+    // Replaces the first match and now overlaps the second one in A
+    input.add(1, 80, 12);
+    // Meets both, the first one is the one checked against
+    input.add(9, 95, 3);
+    input.add(30, 62, 5);
+    std::vector<CommonSubArr> actual = longest_common_substring(input.suffixArr.data(), input.entries, sizeA);
+    expectSameMatches(naiveLongestCommonSubstring(input, sizeA), actual);
+}
+
+TEST(LongestCommonSubstring, RandomMatches)
+{
+    std::mt19937 random(1234);
+    for(int round = 0; round < 50; round++){
+        const int sizeA = 500;
+        MatchInput input;
+        for(int i = 0; i < 400; i++){
+            int length = std::uniform_int_distribution<int>(1, 60)(random);
+            int startA = std::uniform_int_distribution<int>(0, sizeA - length)(random);
+            int startB = std::uniform_int_distribution<int>(sizeA + 1, 2*sizeA + 1 - length)(random);
+            input.add(startA, startB, length);
+        }
+        std::vector<CommonSubArr> expected = naiveLongestCommonSubstring(input, sizeA);
+        expectSameMatches(expected, longest_common_substring(input.suffixArr.data(), input.entries, sizeA));
+
+        // The dense lcp array matchPair passes gives the same matches
+        std::vector<int> lcpArr(input.suffixArr.size(), 0);
+        for(const LcpEntry& entry : input.entries)
+            lcpArr[entry.index] = entry.length;
+        expectSameMatches(expected, longest_common_substring(input.suffixArr.data(), lcpArr.data(), lcpArr.size(), sizeA, 0));
+    }
+}
+
+/*
+Files concatenated the way matchSeason does it, each followed by its own sentinel 1 to files,
+with a suffix array and lcp array sorted by brute force
+*/
+struct SeasonInput{
+    std::vector<int> text;
+    std::vector<int> fileStarts = {0};
+    std::vector<int> suffixArr, lcpArr;
+
+    explicit SeasonInput(const std::vector<std::vector<int>>& files){
+        for(size_t f = 0; f < files.size(); f++){
+            for(int value : files[f])
+                text.push_back(value + files.size() + 1);
+            text.push_back(f + 1);
+            fileStarts.push_back(text.size());
+        }
+        int size = text.size();
+        for(int i = 0; i < size; i++)
+            suffixArr.push_back(i);
+        std::sort(suffixArr.begin(), suffixArr.end(), [this](int a, int b){
+            return std::lexicographical_compare(text.begin() + a, text.end(), text.begin() + b, text.end());
+        });
+        lcpArr.assign(size, 0);
+        for(int i = 1; i < size; i++){
+            int a = suffixArr[i-1], b = suffixArr[i];
+            while(std::max(a, b) + lcpArr[i] < size && text[a + lcpArr[i]] == text[b + lcpArr[i]])
+                lcpArr[i]++;
+        }
+    }
+
+    std::vector<SharedSubArr> shared(int minSupport, int threshold){
+        return shared_substrings(suffixArr.data(), lcpArr.data(), text.size(), fileStarts, minSupport, threshold);
+    }
+};
+
+// Values no other call returns, so nothing matches by chance
+static std::vector<int> uniqueValues(int length){
+    static int next = 1000;
+    std::vector<int> values;
+    for(int i = 0; i < length; i++)
+        values.push_back(next++);
+    return values;
+}
+
+static std::vector<int> join(std::initializer_list<std::vector<int>> parts){
+    std::vector<int> joined;
+    for(const std::vector<int>& part : parts)
+        joined.insert(joined.end(), part.begin(), part.end());
+    return joined;
+}
+
+TEST(SharedSubstrings, FindsRunInEveryFile)
+{
+    std::vector<int> intro = uniqueValues(40);
+    SeasonInput input({
+        join({uniqueValues(10), intro, uniqueValues(5)}),
+        join({intro, uniqueValues(30)}),
+        join({uniqueValues(25), intro}),
+        uniqueValues(20),
+    });
+    std::vector<SharedSubArr> shared = input.shared(2, 3);
+    ASSERT_EQ(1u, shared.size());
+    EXPECT_EQ(40, shared[0].length);
+    EXPECT_EQ(3, shared[0].support);
+    EXPECT_EQ((std::vector<int>{10, 0, 25, -1}), shared[0].starts);
+}
+
+TEST(SharedSubstrings, MinSupportAndThreshold)
+{
+    std::vector<int> intro = uniqueValues(30);
+    std::vector<int> credits = uniqueValues(8);
+    SeasonInput input({
+        join({intro, uniqueValues(4), credits}),
+        join({uniqueValues(7), intro, credits}),
+        join({credits, uniqueValues(9)}),
+    });
+    // The intro is in two files and the credits in all three
+    std::vector<SharedSubArr> shared = input.shared(3, 3);
+    ASSERT_EQ(1u, shared.size());
+    EXPECT_EQ(8, shared[0].length);
+    EXPECT_EQ((std::vector<int>{34, 37, 0}), shared[0].starts);
+
+    shared = input.shared(2, 3);
+    ASSERT_EQ(2u, shared.size());
+    EXPECT_EQ(30, shared[0].length);
+    EXPECT_EQ(2, shared[0].support);
+    EXPECT_EQ((std::vector<int>{0, 7, -1}), shared[0].starts);
+    EXPECT_EQ(3, shared[1].support);
+
+    // Runs must be longer than the threshold
+    EXPECT_EQ(1u, input.shared(2, 8).size());
+    EXPECT_TRUE(input.shared(2, 30).empty());
+}
+
+TEST(SharedSubstrings, StopsAtSentinels)
+{
+    // Files 0 and 2 end the same way, a run through their sentinels would be one longer
+    // File 1 has both halves the other way around, they overlap the longer run and are dropped
+    std::vector<int> head = uniqueValues(12);
+    std::vector<int> tail = uniqueValues(12);
+    SeasonInput input({
+        join({uniqueValues(6), head, tail}),
+        join({tail, head, uniqueValues(6)}),
+        join({head, tail}),
+    });
+    std::vector<SharedSubArr> shared = input.shared(2, 3);
+    ASSERT_EQ(1u, shared.size());
+    EXPECT_EQ(24, shared[0].length);
+    EXPECT_EQ(2, shared[0].support);
+    EXPECT_EQ((std::vector<int>{6, -1, 0}), shared[0].starts);
+    EXPECT_EQ(input.fileStarts[1] - 1, input.fileStarts[0] + shared[0].starts[0] + shared[0].length);
+}
+
+TEST(SharedSubstrings, RandomRunsAreShared)
+{
+    std::mt19937 random(99);
+    for(int round = 0; round < 100; round++){
+        int files = std::uniform_int_distribution<int>(2, 5)(random);
+        std::vector<std::vector<int>> values(files);
+        for(std::vector<int>& file : values){
+            file.resize(std::uniform_int_distribution<int>(0, 60)(random));
+            for(int& value : file)
+                value = random() % 3;
+        }
+        int minSupport = std::uniform_int_distribution<int>(2, files)(random);
+        int threshold = random() % 4;
+        SeasonInput input(values);
+        std::vector<std::vector<std::pair<int, int>>> taken(files);
+        for(const SharedSubArr& run : input.shared(minSupport, threshold)){
+            ASSERT_GT(run.length, threshold);
+            ASSERT_GE(run.support, minSupport);
+            std::vector<int> pattern;
+            for(int f = 0; f < files; f++){
+                if(run.starts[f] >= 0){
+                    pattern.assign(values[f].begin() + run.starts[f], values[f].begin() + run.starts[f] + run.length);
+                    break;
+                }
+            }
+            int support = 0;
+            for(int f = 0; f < files; f++){
+                const std::vector<int>& file = values[f];
+                bool contains = std::search(file.begin(), file.end(), pattern.begin(), pattern.end()) != file.end();
+                if(run.starts[f] < 0){
+                    EXPECT_FALSE(contains) << "Round " << round << " file " << f;
+                    continue;
+                }
+                support++;
+                ASSERT_LE(run.starts[f] + run.length, (int)file.size()) << "Round " << round << " file " << f;
+                EXPECT_TRUE(std::equal(pattern.begin(), pattern.end(), file.begin() + run.starts[f])) << "Round " << round << " file " << f;
+                // Kept runs never overlap in a file
+                for(std::pair<int, int> other : taken[f])
+                    EXPECT_TRUE(other.second <= run.starts[f] || run.starts[f] + run.length <= other.first) << "Round " << round << " file " << f;
+                taken[f].push_back({run.starts[f], run.starts[f] + run.length});
+            }
+            EXPECT_EQ(support, run.support);
+        }
+    }
+}
+
+// One chroma value per item, with sample_rate 10 and item_duration 1 an item is a tenth of a second
+// delay 10 makes runs of 10 items or less too short and gaps of up to 50 mergeable, the offset tolerance is 2 items
+struct SeasonChromas{
+    std::vector<std::vector<uint32_t>> values;
+
+    std::vector<SeasonSegment> match(int minSupport){
+        std::vector<ChromaArr> chromas;
+        for(std::vector<uint32_t>& file : values)
+            chromas.push_back((struct ChromaArr){file.data(), (int)file.size(), false, nullptr, 0});
+        return matchSeason(chromas, minSupport, 10, 10, 1);
+    }
+};
+
+static std::vector<uint32_t> randomChroma(std::mt19937& random, int length){
+    std::vector<uint32_t> values(length);
+    for(uint32_t& value : values)
+        value = random();
+    return values;
+}
+
+static std::vector<uint32_t> joinChroma(std::initializer_list<std::vector<uint32_t>> parts){
+    std::vector<uint32_t> joined;
+    for(const std::vector<uint32_t>& part : parts)
+        joined.insert(joined.end(), part.begin(), part.end());
+    return joined;
+}
+
+static void expectRange(TimeRange expected, TimeRange actual, int file){
+    EXPECT_DOUBLE_EQ(expected.start, actual.start) << "File " << file;
+    EXPECT_DOUBLE_EQ(expected.end, actual.end) << "File " << file;
+}
+
+TEST(MatchSeason, IntroInThreeFiles)
+{
+    std::mt19937 random(5);
+    std::vector<uint32_t> intro = randomChroma(random, 100);
+    SeasonChromas season;
+    season.values = {
+        joinChroma({randomChroma(random, 30), intro, randomChroma(random, 70)}),
+        joinChroma({intro, randomChroma(random, 50)}),
+        joinChroma({randomChroma(random, 80), intro}),
+        randomChroma(random, 150),
+    };
+    std::vector<SeasonSegment> segments = season.match(2);
+    ASSERT_EQ(1u, segments.size());
+    EXPECT_EQ(3, segments[0].support);
+    expectRange((struct TimeRange){3, 14}, segments[0].ranges[0], 0);
+    expectRange((struct TimeRange){0, 11}, segments[0].ranges[1], 1);
+    expectRange((struct TimeRange){8, 19}, segments[0].ranges[2], 2);
+    expectRange((struct TimeRange){-1, -1}, segments[0].ranges[3], 3);
+
+    // Only in three files
+    EXPECT_TRUE(season.match(4).empty());
+}
+
+TEST(MatchSeason, MinSupport)
+{
+    std::mt19937 random(6);
+    std::vector<uint32_t> intro = randomChroma(random, 60);
+    std::vector<uint32_t> credits = randomChroma(random, 40);
+    SeasonChromas season;
+    season.values = {
+        joinChroma({intro, randomChroma(random, 100), credits}),
+        joinChroma({randomChroma(random, 20), intro, randomChroma(random, 100), credits}),
+        joinChroma({randomChroma(random, 100), credits}),
+    };
+    std::vector<SeasonSegment> segments = season.match(3);
+    ASSERT_EQ(1u, segments.size());
+    EXPECT_EQ(3, segments[0].support);
+    expectRange((struct TimeRange){16, 21}, segments[0].ranges[0], 0);
+
+    segments = season.match(2);
+    ASSERT_EQ(2u, segments.size());
+    EXPECT_EQ(2, segments[0].support);
+    expectRange((struct TimeRange){0, 7}, segments[0].ranges[0], 0);
+    expectRange((struct TimeRange){2, 9}, segments[0].ranges[1], 1);
+    expectRange((struct TimeRange){-1, -1}, segments[0].ranges[2], 2);
+    EXPECT_EQ(3, segments[1].support);
+}
+
+TEST(MatchSeason, MergedRunsStayInsideFiles)
+{
+    /*
+    X then Y in files 0 and 1 with a gap that looks alike in between, so the two merge into one run
+    File 2 has Y too close to its start for X to fit in front of it and file 3 has X too close to its end for Y to fit after it
+    */
+    std::mt19937 random(7);
+    std::vector<uint32_t> x = randomChroma(random, 30);
+    std::vector<uint32_t> y = randomChroma(random, 30);
+    std::vector<uint32_t> gap = randomChroma(random, 10);
+    std::vector<uint32_t> similarGap = gap;
+    // One field of 16 differs in every word
+    for(uint32_t& value : similarGap)
+        value ^= 1;
+    SeasonChromas season;
+    season.values = {
+        joinChroma({randomChroma(random, 20), x, gap, y, randomChroma(random, 20)}),
+        joinChroma({randomChroma(random, 40), x, similarGap, y, randomChroma(random, 10)}),
+        joinChroma({randomChroma(random, 5), y, randomChroma(random, 50)}),
+        joinChroma({randomChroma(random, 50), x}),
+    };
+    std::vector<SeasonSegment> segments = season.match(2);
+    // Y in file 2 is taken into the run without file 2
+    ASSERT_EQ(1u, segments.size());
+    const SeasonSegment& merged = segments[0];
+    EXPECT_EQ(3, merged.support);
+    expectRange((struct TimeRange){2, 10}, merged.ranges[0], 0);
+    expectRange((struct TimeRange){4, 12}, merged.ranges[1], 1);
+    expectRange((struct TimeRange){-1, -1}, merged.ranges[2], 2);
+    // Ends at the end of file 3
+    expectRange((struct TimeRange){5, 9}, merged.ranges[3], 3);
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <audio/PcmConvert.hpp>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+static void put24(std::vector<uint8_t>& bytes, int32_t sample){
+    bytes.push_back(sample & 0xFF);
+    bytes.push_back((sample >> 8) & 0xFF);
+    bytes.push_back((sample >> 16) & 0xFF);
+}
+
+template<typename T>
+static void put(std::vector<uint8_t>& bytes, T sample){
+    size_t end = bytes.size();
+    bytes.resize(end + sizeof(T));
+    memcpy(bytes.data() + end, &sample, sizeof(T));
+}
+
+// Full scale on both ends, zero, the smallest steps and values around the rounding points, then random ones
+static std::vector<int32_t> pcm24Samples(std::mt19937& random, int count){
+    std::vector<int32_t> samples = {8388607, -8388608, 0, 1, -1, 8388606, -8388607};
+    for(int k : {1, 100, 32766}){
+        // (k + 0.5) / 32767 of full scale and its neighbours
+        int32_t half = (int32_t)std::lround((k + 0.5) * 8388608.0 / 32767);
+        for(int32_t sample : {half - 1, half, half + 1}){
+            samples.push_back(sample);
+            samples.push_back(-sample);
+        }
+    }
+    while((int)samples.size() < count)
+        samples.push_back((int32_t)(random() & 0xFFFFFF) - 8388608);
+    return samples;
+}
+
+static std::vector<int32_t> pcm32Samples(std::mt19937& random, int count){
+    std::vector<int32_t> samples = {INT32_MAX, INT32_MIN, 0, 1, -1, INT32_MAX - 1, INT32_MIN + 1, 65536, -65536, 98304, -98304};
+    while((int)samples.size() < count)
+        samples.push_back((int32_t)random());
+    return samples;
+}
+
+static std::vector<float> floatSamples(std::mt19937& random, int count){
+    const float infinity = std::numeric_limits<float>::infinity();
+    std::vector<float> samples = {
+        1.f, -1.f, 0.f, -0.f, 1.5f, -1.5f, 1e30f, -1e30f, infinity, -infinity,
+        std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+        std::numeric_limits<float>::denorm_min(), 0.5f / 32767, -0.5f / 32767, 1.5f / 32767, -32767.5f / 32767,
+        std::nextafter(1.f, 2.f), std::nextafter(-1.f, -2.f)
+    };
+    std::uniform_real_distribution<float> range(-1.2f, 1.2f);
+    while((int)samples.size() < count)
+        samples.push_back(range(random));
+    return samples;
+}
+
+// Runs kernel over every length up to the sample count, at every byte offset, and checks it against scaleToInt16
+static void expectKernelMatches(const char* name, const char* format, ConvertKernel kernel, const std::vector<uint8_t>& bytes,
+    const std::vector<int16_t>& expected){
+    int count = expected.size();
+    for(int offset = 0; offset < 4; offset++){
+        // Unaligned copies that end right after the last sample
+        std::vector<uint8_t> in(offset + bytes.size());
+        std::copy(bytes.begin(), bytes.end(), in.begin() + offset);
+        for(int length = 0; length <= count; length++){
+            std::vector<int16_t> out(length + 1, 0x5A5A);
+            kernel(in.data() + offset, out.data(), length);
+            for(int i = 0; i < length; i++)
+                ASSERT_EQ(expected[i], out[i]) << name << " " << format << " length " << length << " offset " << offset << " index " << i;
+            ASSERT_EQ(0x5A5A, out[length]) << name << " " << format << " wrote past length " << length;
+        }
+    }
+}
+
+TEST(PcmConvert, KernelsMatchScaleToInt16)
+{
+    std::mt19937 random(4);
+    const int count = 75;
+    std::vector<uint8_t> bytes24, bytes32, bytesFloat;
+    std::vector<int16_t> expected24, expected32, expectedFloat;
+    for(int32_t sample : pcm24Samples(random, count)){
+        put24(bytes24, sample);
+        expected24.push_back(scaleToInt16((float)sample / 8388608.f));
+    }
+    for(int32_t sample : pcm32Samples(random, count)){
+        put(bytes32, sample);
+        expected32.push_back(scaleToInt16((float)sample / 2147483648.f));
+    }
+    for(float sample : floatSamples(random, count)){
+        put(bytesFloat, sample);
+        expectedFloat.push_back(scaleToInt16(sample));
+    }
+    for(const ConvertKernels& kernel : convertKernels()){
+        expectKernelMatches(kernel.name, "24 bit", kernel.pcm24, bytes24, expected24);
+        expectKernelMatches(kernel.name, "32 bit", kernel.pcm32, bytes32, expected32);
+        expectKernelMatches(kernel.name, "float", kernel.float32, bytesFloat, expectedFloat);
+    }
+}
+
+TEST(PcmConvert, KernelsAgreeOnLongInput)
+{
+    std::mt19937 random(9);
+    const int count = 10007;
+    std::vector<uint8_t> bytes24, bytes32, bytesFloat;
+    for(int32_t sample : pcm24Samples(random, count))
+        put24(bytes24, sample);
+    for(int32_t sample : pcm32Samples(random, count))
+        put(bytes32, sample);
+    for(float sample : floatSamples(random, count))
+        put(bytesFloat, sample);
+    std::vector<ConvertKernels> kernels = convertKernels();
+    std::vector<int16_t> expected(count), out(count);
+    for(auto [kernelOf, bytes] : {
+        std::make_pair(&ConvertKernels::pcm24, &bytes24),
+        std::make_pair(&ConvertKernels::pcm32, &bytes32),
+        std::make_pair(&ConvertKernels::float32, &bytesFloat)}){
+        (kernels[0].*kernelOf)(bytes->data(), expected.data(), count);
+        for(const ConvertKernels& kernel : kernels){
+            (kernel.*kernelOf)(bytes->data(), out.data(), count);
+            EXPECT_EQ(expected, out) << kernel.name;
+        }
+    }
+}
+
+TEST(PcmConvert, ScaleToInt16Edges)
+{
+    EXPECT_EQ(32767, scaleToInt16(1.f));
+    EXPECT_EQ(-32767, scaleToInt16(-1.f));
+    EXPECT_EQ(0, scaleToInt16(0.f));
+    // Out of range saturates, below -1 reaches -32768 which -1 itself doesn't
+    EXPECT_EQ(32767, scaleToInt16(1.5f));
+    EXPECT_EQ(-32768, scaleToInt16(-1.5f));
+    EXPECT_EQ(32767, scaleToInt16(std::numeric_limits<float>::infinity()));
+    EXPECT_EQ(-32768, scaleToInt16(-std::numeric_limits<float>::infinity()));
+    EXPECT_EQ(32767, scaleToInt16(std::numeric_limits<float>::quiet_NaN()));
+    // Halves round away from zero
+    EXPECT_EQ(1, scaleToInt16(0.5f / 32767));
+    EXPECT_EQ(-1, scaleToInt16(-0.5f / 32767));
+}
+
+// A wav whose data chunk is bytes, the way the mapper describes it
+static MappedWav wavOf(const std::vector<uint8_t>& bytes, int audioFormat, int bitDepth, int channels){
+    MappedWav wav;
+    wav.data = bytes.data();
+    wav.dataSize = bytes.size();
+    wav.audioFormat = audioFormat;
+    wav.channels = channels;
+    wav.sample_rate = 44100;
+    wav.bitDepth = bitDepth;
+    wav.blockAlign = channels * bitDepth / 8;
+    return wav;
+}
+
+static std::vector<int16_t> convert(const MappedWav& wav, size_t firstFrame, size_t frames){
+    std::vector<int16_t> out(frames * wav.channels);
+    convertToInt16(wav, firstFrame, frames, out.data());
+    return out;
+}
+
+TEST(PcmConvert, ConvertsEveryFormat)
+{
+    std::vector<uint8_t> bytes8 = {0, 255, 128, 127, 129, 64};
+    EXPECT_EQ((std::vector<int16_t>{-32767, 32511, 0, -256, 256, -16384}), convert(wavOf(bytes8, wavFormatPCM, 8, 2), 0, 3));
+
+    // 16 bit is copied as it is, full scale included
+    std::vector<uint8_t> bytes16;
+    for(int16_t sample : {32767, -32768, 0, 16417, -16417, 1})
+        put(bytes16, sample);
+    EXPECT_EQ((std::vector<int16_t>{32767, -32768, 0, 16417, -16417, 1}), convert(wavOf(bytes16, wavFormatPCM, 16, 2), 0, 3));
+    // Unaligned data too
+    std::vector<uint8_t> shifted = {0};
+    shifted.insert(shifted.end(), bytes16.begin(), bytes16.end());
+    MappedWav unaligned = wavOf(shifted, wavFormatPCM, 16, 2);
+    unaligned.data++;
+    EXPECT_EQ((std::vector<int16_t>{0, 16417, -16417, 1}), convert(unaligned, 1, 2));
+
+    std::vector<uint8_t> bytes24;
+    for(int32_t sample : {8388607, -8388608, 0, 4194304})
+        put24(bytes24, sample);
+    EXPECT_EQ((std::vector<int16_t>{32767, -32767, 0, 16384}), convert(wavOf(bytes24, wavFormatPCM, 24, 1), 0, 4));
+
+    std::vector<uint8_t> bytes32;
+    for(int32_t sample : {INT32_MAX, INT32_MIN, 0, -1073741824})
+        put(bytes32, sample);
+    EXPECT_EQ((std::vector<int16_t>{32767, -32767, 0, -16384}), convert(wavOf(bytes32, wavFormatPCM, 32, 1), 0, 4));
+
+    std::vector<uint8_t> bytesFloat;
+    for(float sample : {1.f, -1.f, 2.f, -2.f, std::numeric_limits<float>::quiet_NaN(), 0.25f})
+        put(bytesFloat, sample);
+    EXPECT_EQ((std::vector<int16_t>{-32768, 32767, 8192}), convert(wavOf(bytesFloat, wavFormatFloat, 32, 1), 3, 3));
+    EXPECT_EQ((std::vector<int16_t>{32767, -32767, 32767, -32768}), convert(wavOf(bytesFloat, wavFormatFloat, 32, 2), 0, 2));
+}
+
+TEST(PcmConvert, CanConvertToInt16)
+{
+    std::vector<uint8_t> empty;
+    for(int bitDepth : {8, 16, 24, 32})
+        EXPECT_TRUE(canConvertToInt16(wavOf(empty, wavFormatPCM, bitDepth, 1))) << bitDepth;
+    EXPECT_FALSE(canConvertToInt16(wavOf(empty, wavFormatPCM, 12, 1)));
+    EXPECT_TRUE(canConvertToInt16(wavOf(empty, wavFormatFloat, 32, 1)));
+    EXPECT_FALSE(canConvertToInt16(wavOf(empty, wavFormatFloat, 64, 1)));
+    EXPECT_FALSE(canConvertToInt16(wavOf(empty, wavFormatExtensible, 16, 1)));
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <audio/SampleCompare.hpp>
+#include <random>
+#include <span>
+#include <vector>
+
+// Lengths past two AVX2 steps, so a mismatch lands at every offset modulo 8, 16 and 32 in every loop of every kernel
+static const size_t maxLength = 100;
+
+// A mismatch at every position of every length, from every start offset so the loads are unaligned too
+TEST(SampleCompare, KernelsMatchScalarAtEveryOffset)
+{
+    std::mt19937 random(5);
+    std::vector<int16_t> a(maxLength + 16), b;
+    for(int16_t& sample : a)
+        sample = (int16_t)random();
+    // Differing in the low byte only and in the high byte only, a bytewise compare would get one of them wrong
+    for(int16_t flip : {(int16_t)0x0001, (int16_t)0x0100, (int16_t)0x8000}){
+        for(const CompareKernels& kernel : compareKernels()){
+            for(size_t offset = 0; offset < 16; offset++){
+                for(size_t length = 0; length <= maxLength; length++){
+                    const int16_t* start = a.data() + offset;
+                    b = a;
+                    const int16_t* other = b.data() + offset;
+                    ASSERT_EQ(length, kernel.prefix(start, other, length)) << kernel.name << " length " << length << " offset " << offset;
+                    ASSERT_EQ(length, kernel.suffix(start + length, other + length, length)) << kernel.name << " length " << length << " offset " << offset;
+                    for(size_t mismatch = 0; mismatch < length; mismatch++){
+                        b[offset + mismatch] ^= flip;
+                        // A second mismatch further in must not move the first one
+                        if(mismatch + 5 < length)
+                            b[offset + mismatch + 5] ^= flip;
+                        ASSERT_EQ(mismatch, kernel.prefix(start, other, length)) << kernel.name << " length " << length << " offset " << offset << " mismatch " << mismatch;
+                        b[offset + mismatch] ^= flip;
+                        if(mismatch + 5 < length)
+                            b[offset + mismatch + 5] ^= flip;
+
+                        size_t fromEnd = length - 1 - mismatch;
+                        b[offset + fromEnd] ^= flip;
+                        if(fromEnd >= 5)
+                            b[offset + fromEnd - 5] ^= flip;
+                        ASSERT_EQ(mismatch, kernel.suffix(start + length, other + length, length)) << kernel.name << " length " << length << " offset " << offset << " mismatch " << mismatch;
+                        b[offset + fromEnd] ^= flip;
+                        if(fromEnd >= 5)
+                            b[offset + fromEnd - 5] ^= flip;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(SampleCompare, KernelsAgreeOnRandomInput)
+{
+    std::mt19937 random(12);
+    std::vector<CompareKernels> kernels = compareKernels();
+    for(int round = 0; round < 2000; round++){
+        size_t length = random() % 300;
+        std::vector<int16_t> a(length), b(length);
+        for(size_t i = 0; i < length; i++)
+            a[i] = b[i] = (int16_t)random();
+        // Up to three mismatches anywhere
+        for(int k = random() % 4; k > 0 && length > 0; k--)
+            b[random() % length] ^= (int16_t)(1 + random() % 0xFFFF);
+        size_t prefix = kernels[0].prefix(a.data(), b.data(), length);
+        size_t suffix = kernels[0].suffix(a.data() + length, b.data() + length, length);
+        for(const CompareKernels& kernel : kernels){
+            ASSERT_EQ(prefix, kernel.prefix(a.data(), b.data(), length)) << kernel.name << " round " << round;
+            ASSERT_EQ(suffix, kernel.suffix(a.data() + length, b.data() + length, length)) << kernel.name << " round " << round;
+        }
+    }
+}
+
+TEST(SampleCompare, EmptyAndUnequalLengths)
+{
+    std::vector<int16_t> empty;
+    std::vector<int16_t> samples = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    EXPECT_EQ(0u, commonPrefixLength(empty, empty));
+    EXPECT_EQ(0u, commonSuffixLength(empty, empty));
+    EXPECT_EQ(0u, commonPrefixLength(empty, samples));
+    EXPECT_EQ(0u, commonSuffixLength(samples, empty));
+
+    // The shorter one decides, the prefix counts from the front of both and the suffix from the back of both
+    std::span<const int16_t> all(samples);
+    EXPECT_EQ(4u, commonPrefixLength(all, all.first(4)));
+    EXPECT_EQ(4u, commonPrefixLength(all.first(4), all));
+    EXPECT_EQ(4u, commonSuffixLength(all, all.last(4)));
+    EXPECT_EQ(4u, commonSuffixLength(all.last(4), all));
+    EXPECT_EQ(0u, commonPrefixLength(all, all.last(4)));
+    EXPECT_EQ(0u, commonSuffixLength(all, all.first(4)));
+
+    // Long enough for the vector loops, with the tail of the shorter one equal to the longer one
+    std::vector<int16_t> longer(1000), shorter;
+    for(size_t i = 0; i < longer.size(); i++)
+        longer[i] = (int16_t)(i * 7);
+    shorter.assign(longer.begin() + 400, longer.end());
+    EXPECT_EQ(600u, commonSuffixLength(longer, shorter));
+    EXPECT_EQ(0u, commonPrefixLength(longer, shorter));
+    shorter.assign(longer.begin(), longer.begin() + 777);
+    EXPECT_EQ(777u, commonPrefixLength(shorter, longer));
+    shorter[500] = -1;
+    EXPECT_EQ(500u, commonPrefixLength(shorter, longer));
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <audio/Silence.hpp>
+#include <matcher.hpp>
+#include <random>
+#include <vector>
+
+// Blocks of 80 frames
+static const int sample_rate = 8000;
+
+static void expectSameRanges(const std::vector<TimeRange>& expected, const std::vector<TimeRange>& actual, const char* what){
+    ASSERT_EQ(expected.size(), actual.size()) << what;
+    for(size_t i = 0; i < expected.size(); i++){
+        EXPECT_EQ(expected[i].start, actual[i].start) << what << " index " << i;
+        EXPECT_EQ(expected[i].end, actual[i].end) << what << " index " << i;
+    }
+}
+
+TEST(Silence, LevelKernelsMatchScalar)
+{
+    std::mt19937 random(6);
+    std::vector<int16_t> samples(120);
+    for(int16_t& sample : samples)
+        sample = (int16_t)random();
+    // Both ends of the range, -32768 has to count as 32768
+    samples[3] = -32768; samples[20] = 32767; samples[41] = -32768; samples[66] = -1;
+    std::vector<LevelKernels> kernels = levelKernels();
+    for(const LevelKernels& kernel : kernels){
+        for(size_t offset = 0; offset < 16; offset++){
+            for(size_t count = 0; offset + count <= samples.size(); count++)
+                ASSERT_EQ(kernels[0].level(samples.data() + offset, count), kernel.level(samples.data() + offset, count))
+                    << kernel.name << " offset " << offset << " count " << count;
+        }
+    }
+
+    // Full scale all the way, long enough that the 32 bit lanes are emptied into the total a few times
+    std::vector<int16_t> loud(3 * 16 * 8192 * 2 + 37, -32768);
+    for(const LevelKernels& kernel : kernels)
+        EXPECT_EQ(32768ULL * loud.size(), kernel.level(loud.data(), loud.size())) << kernel.name;
+}
+
+/*
+Stereo noise, loud apart from quiet stretches. The ones here start and end on blocks:
+one exactly silenceThreshold long, one a block shorter that isn't a silence, and one running to the end
+of the audio, which stops in the middle of a block
+*/
+static std::vector<int16_t> blockAlignedSignal(int frames, std::mt19937& random){
+    std::vector<int16_t> samples(frames * 2);
+    for(int i = 0; i < frames; i++){
+        bool quiet = (i >= 800 && i < 4800) || (i >= 8000 && i < 11920) || i >= 16000;
+        int amplitude = quiet ? 300 : 20000;
+        for(int ch = 0; ch < 2; ch++)
+            samples[2*i + ch] = (int16_t)((int)(random() % (2*amplitude + 1)) - amplitude);
+    }
+    return samples;
+}
+
+// Feeds frames in pieces of random size, zero and a single frame included, none of them lining up with blocks
+static std::vector<TimeRange> feedInPieces(const std::vector<int16_t>& samples, int channels, std::mt19937& random){
+    SilenceDetector detector(sample_rate, channels);
+    size_t frames = samples.size() / channels;
+    size_t fed = 0;
+    while(fed < frames){
+        size_t piece = std::min<size_t>(frames - fed, random() % 4 == 0 ? random() % 2 : random() % 250);
+        detector.feed(samples.data() + fed*channels, piece);
+        fed += piece;
+    }
+    return detector.finish();
+}
+
+TEST(Silence, DetectorFindsSilences)
+{
+    std::mt19937 random(2);
+    const int frames = 20037;
+    std::vector<int16_t> samples = blockAlignedSignal(frames, random);
+    std::vector<TimeRange> expected = {
+        (struct TimeRange){800.0 / sample_rate, 4800.0 / sample_rate},
+        (struct TimeRange){16000.0 / sample_rate, (double)frames / sample_rate},
+    };
+    SilenceDetector detector(sample_rate, 2);
+    detector.feed(samples.data(), frames);
+    expectSameRanges(expected, detector.finish(), "all at once");
+    expectSameRanges(expected, feedInPieces(samples, 2, random), "in pieces");
+}
+
+TEST(Silence, DetectorSameAcrossBlockBoundaries)
+{
+    std::mt19937 random(15);
+    size_t found = 0;
+    for(int round = 0; round < 50; round++){
+        // Quiet and loud stretches of any length, so block edges land anywhere in them
+        int channels = 1 + round % 2;
+        std::vector<int16_t> samples;
+        bool quiet = round % 3 == 0;
+        while(samples.size() < 40000u * channels){
+            int length = 1 + random() % (quiet ? 9000 : 3000);
+            int amplitude = quiet ? 200 + random() % 200 : 2000 + random() % 20000;
+            for(int i = 0; i < length * channels; i++)
+                samples.push_back((int16_t)((int)(random() % (2*amplitude + 1)) - amplitude));
+            quiet = !quiet;
+        }
+        SilenceDetector detector(sample_rate, channels);
+        detector.feed(samples.data(), samples.size() / channels);
+        std::vector<TimeRange> whole = detector.finish();
+        expectSameRanges(whole, feedInPieces(samples, channels, random), "in pieces");
+        // One frame at a time
+        SilenceDetector frameByFrame(sample_rate, channels);
+        for(size_t i = 0; i < samples.size(); i += channels)
+            frameByFrame.feed(samples.data() + i, 1);
+        expectSameRanges(whole, frameByFrame.finish(), "frame by frame");
+        if(HasFailure())
+            return;
+        found += whole.size();
+    }
+    EXPECT_GT(found, 100u);
+}
+
+TEST(Silence, SnapToSilenceWithinTolerance)
+{
+    std::vector<TimeRange> silence = {(struct TimeRange){10, 12}, (struct TimeRange){30, 31}};
+    auto snap = [&](double start, double end, double tolerance){ return snapToSilence((struct TimeRange){start, end}, silence, tolerance); };
+    // The start moves to the start of a silence and the end to the end of one
+    expectSameRanges({(struct TimeRange){10, 31}}, {snap(9, 29, 2)}, "close");
+    // Exactly tolerance away still snaps, anything further doesn't
+    expectSameRanges({(struct TimeRange){10, 31}}, {snap(8, 33, 2)}, "at tolerance");
+    expectSameRanges({(struct TimeRange){7.5, 33.5}}, {snap(7.5, 33.5, 2)}, "past tolerance");
+    expectSameRanges({(struct TimeRange){10, 33.5}}, {snap(8, 33.5, 2)}, "only the start");
+    // Inside a silence is no distance at all
+    expectSameRanges({(struct TimeRange){10, 31}}, {snap(11, 30.5, 0)}, "inside");
+    expectSameRanges({(struct TimeRange){9, 29}}, {snap(9, 29, 0)}, "no tolerance");
+    expectSameRanges({(struct TimeRange){9, 29}}, {snapToSilence((struct TimeRange){9, 29}, {}, 5)}, "no silence");
+
+    // The closest silence wins
+    silence = {(struct TimeRange){10, 12}, (struct TimeRange){13, 14}, (struct TimeRange){20, 21}};
+    expectSameRanges({(struct TimeRange){13, 21}}, {snap(12.6, 19.9, 3)}, "closest");
+    expectSameRanges({(struct TimeRange){10, 14}}, {snap(12.4, 14.5, 3)}, "closest before");
+
+    // A range that would snap onto nothing keeps its own ends
+    silence = {(struct TimeRange){5, 5}};
+    expectSameRanges({(struct TimeRange){4.9, 5.1}}, {snap(4.9, 5.1, 1)}, "empty");
+}
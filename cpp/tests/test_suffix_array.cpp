@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <suffix_array.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Suffixes sorted by comparing them whole, a suffix that is a prefix of another comes first
+static std::vector<int> naiveSuffixArray(const std::vector<int>& s){
+    std::vector<int> SA(s.size());
+    std::iota(SA.begin(), SA.end(), 0);
+    std::sort(SA.begin(), SA.end(), [&s](int a, int b){
+        return std::lexicographical_compare(s.begin() + a, s.end(), s.begin() + b, s.end());
+    });
+    return SA;
+}
+
+template<typename Index>
+static void expectSameSuffixArray(const std::vector<int>& s, int K, SuffixArrayWorkspace<Index>& workspace){
+    std::vector<Index> SA(s.size(), -1);
+    build_suffix_array<Index>(s.data(), (Index)s.size(), K, SA.data(), workspace);
+    std::vector<int> expected = naiveSuffixArray(s);
+    for(size_t i = 0; i < s.size(); i++)
+        ASSERT_EQ(expected[i], SA[i]) << "size " << s.size() << " K " << K << " index " << i << " with " << sizeof(Index)*8 << " bit indices";
+}
+
+// Checks the 32 and 64 bit builds and the per thread suffix_array
+static void expectSameSuffixArray(const std::vector<int>& s, int K){
+    SuffixArrayWorkspace<int32_t> workspace32;
+    SuffixArrayWorkspace<int64_t> workspace64;
+    expectSameSuffixArray<int32_t>(s, K, workspace32);
+    expectSameSuffixArray<int64_t>(s, K, workspace64);
+    int* SA = suffix_array(s.data(), s.size(), K);
+    EXPECT_TRUE(std::equal(SA, SA + s.size(), naiveSuffixArray(s).begin())) << "suffix_array size " << s.size() << " K " << K;
+    delete[] SA;
+}
+
+TEST(SuffixArray, ShortStrings)
+{
+    expectSameSuffixArray({}, 1);
+    expectSameSuffixArray({0}, 1);
+    expectSameSuffixArray({1, 0}, 2);
+    expectSameSuffixArray({0, 1}, 2);
+    // banana
+    expectSameSuffixArray({1, 0, 2, 0, 2, 0}, 3);
+    // mississippi
+    expectSameSuffixArray({1, 0, 3, 3, 0, 3, 3, 0, 2, 2, 0}, 4);
+}
+
+TEST(SuffixArray, RepeatedStrings)
+{
+    for(int size : {1, 2, 3, 17, 1000}){
+        expectSameSuffixArray(std::vector<int>(size, 0), 1);
+        expectSameSuffixArray(std::vector<int>(size, 5), 6);
+    }
+    // Periodic strings make the reduced string repeat too, so the recursion goes several levels deep
+    for(int period : {2, 3, 7}){
+        std::vector<int> s;
+        for(int i = 0; i < 3000; i++)
+            s.push_back(i % period);
+        expectSameSuffixArray(s, period);
+    }
+}
+
+TEST(SuffixArray, LmsHeavyStrings)
+{
+    // Every other position is LMS
+    std::vector<int> alternating;
+    for(int i = 0; i < 2001; i++)
+        alternating.push_back(i % 2 ? 0 : 1);
+    expectSameSuffixArray(alternating, 2);
+
+    // LMS substrings that are equal and differ only late, so naming has to compare them whole
+    std::vector<int> valleys;
+    for(int i = 0; i < 500; i++){
+        for(int value : {3, 1, 2, 1, 3, 1, 2, 0})
+            valleys.push_back(value == 0 && i % 7 == 0 ? 2 : value);
+    }
+    expectSameSuffixArray(valleys, 4);
+
+    // Fibonacci word, the classic worst case for repeats
+    std::vector<int> a = {0}, b = {0, 1};
+    while(b.size() < 5000){
+        std::vector<int> next = b;
+        next.insert(next.end(), a.begin(), a.end());
+        a = b; b = next;
+    }
+    expectSameSuffixArray(b, 2);
+}
+
+TEST(SuffixArray, RandomStrings)
+{
+    std::mt19937 random(21);
+    SuffixArrayWorkspace<int32_t> workspace32;
+    SuffixArrayWorkspace<int64_t> workspace64;
+    // One workspace for all of them, the way suffix_array reuses its buffers between builds
+    for(int round = 0; round < 200; round++){
+        int size = random() % 600;
+        int K = 1 + random() % (round % 2 ? 3 : 300);
+        std::vector<int> s(size);
+        for(int& value : s)
+            value = random() % K;
+        expectSameSuffixArray<int32_t>(s, K, workspace32);
+        expectSameSuffixArray<int64_t>(s, K, workspace64);
+    }
+}
+
+TEST(SuffixArray, SentinelLayouts)
+{
+    std::mt19937 random(8);
+    // matchPair: A, a 0 sentinel and B with ranks from 2, B repeating part of A
+    std::vector<int> pair;
+    for(int i = 0; i < 400; i++)
+        pair.push_back(2 + random() % 5);
+    std::vector<int> repeated(pair.begin() + 100, pair.begin() + 300);
+    pair.push_back(0);
+    pair.insert(pair.end(), repeated.begin(), repeated.end());
+    for(int i = 0; i < 150; i++)
+        pair.push_back(2 + random() % 5);
+    expectSameSuffixArray(pair, 7);
+
+    // matchSeason: every file followed by its own sentinel 1 to files, the other ranks above them
+    const int files = 4;
+    std::vector<int> season;
+    std::vector<int> intro;
+    for(int i = 0; i < 60; i++)
+        intro.push_back(files + 1 + random() % 3);
+    for(int f = 0; f < files; f++){
+        for(int i = random() % 50; i > 0; i--)
+            season.push_back(files + 1 + random() % 3);
+        season.insert(season.end(), intro.begin(), intro.end());
+        season.push_back(f + 1);
+    }
+    expectSameSuffixArray(season, files + 4);
+}